@@ -29,6 +29,8 @@ namespace bubi {
 
 		int64_t begin_time = utils::Timestamp::HighResolution();
 		const Json::Value &json_items = body["items"];
+		std::vector<TransactionFrm::pointer> txs;
+		std::vector<Json::UInt> tx_items;
 		for (size_t j = 0; j < json_items.size() && running; j++) {
 			const Json::Value &json_item = json_items[j];
 			Json::Value &result_item = results[results.size()];
@@ -161,18 +163,31 @@ namespace bubi {
 					result_item["hash"] = utils::String::BinToHexString(HashWrapper::Crypto(content));
 				}
 
-				TransactionFrm frm(tran_env);
-				if (!frm.CheckValid(-1)){
-					result = frm.result_;
-					break;
-				}
-
 			} while (false);
 
 			if (result.code() == protocol::ERRCODE_SUCCESS) {
-				TransactionFrm::pointer ptr = std::make_shared<TransactionFrm>(tran_env);
+				txs.push_back(std::make_shared<TransactionFrm>(tran_env, false));
+				tx_items.push_back(results.size() - 1);
+				continue;
+			}
+			result_item["error_code"] = result.code();
+			result_item["error_desc"] = result.desc();
+		}
+
+		//the signatures of the whole request are checked in one batch
+		TransactionFrm::VerifySignatures(txs, NULL);
+		for (size_t i = 0; i < txs.size(); i++) {
+			TransactionFrm::pointer ptr = txs[i];
+			Json::Value &result_item = results[tx_items[i]];
+			Result result;
+			if (!ptr->CheckValid(-1)) {
+				result = ptr->result_;
+			}
+			else {
+				result.set_code(protocol::ERRCODE_SUCCESS);
+				result.set_desc("");
 				GlueManager::Instance().OnTransaction(ptr, result);
-				PeerManager::Instance().Broadcast(protocol::OVERLAY_MSGTYPE_TRANSACTION, tran_env.SerializeAsString());
+				PeerManager::Instance().Broadcast(protocol::OVERLAY_MSGTYPE_TRANSACTION, ptr->GetTransactionEnv().SerializeAsString());
 				if (result.code() == protocol::ERRCODE_SUCCESS) success_count++;
 			}
 			result_item["error_code"] = result.code();
@@ -116,9 +116,12 @@ namespace bubi {
 		std::string key = request.GetParamValue("key");
 		auto location = utils::String::HexStringToBin(key);
 		std::vector<std::string> values;
-		auto x = LedgerManager::Instance().tree_->GetNode(location);
 		Json::Value ret;
-		ret["ret"] = bubi::Proto2Json(x);
+		do {
+			utils::MutexGuard guard(LedgerManager::Instance().tree_mutex_);
+			auto x = LedgerManager::Instance().tree_->GetNode(location);
+			ret["ret"] = bubi::Proto2Json(x);
+		} while (false);
 		ret["NEW"] = NodeFrm::NEWCOUNT;
 		ret["DEL"] = NodeFrm::DELCOUNT;
 
@@ -335,13 +338,24 @@ namespace bubi {
 				result["total_count"] = list.entry_size();
 			}
 
+			//read the whole page in one batch
+			std::vector<std::string> keys;
 			for (int32_t i = start_int; 
 				i < list.entry_size() &&
-				error_code == protocol::ERRCODE_SUCCESS &&
 				i < start_int + limit_int; 
 				i++) {
+				keys.push_back(ComposePrefix(General::TRANSACTION_PREFIX, list.entry(i)));
+			}
+
+			std::vector<std::string> values;
+			std::vector<int32_t> results;
+			if (!db->MultiGet(keys, values, results)) {
+				LOG_ERROR("Get transaction failed, %s", db->error_desc().c_str());
+			}
+
+			for (size_t i = 0; i < keys.size(); i++) {
 				TransactionFrm txfrm;
-				if (txfrm.LoadFromDb(list.entry(i)) > 0) {
+				if (results[i] <= 0 || txfrm.LoadFromStore(list.entry(start_int + (int32_t)i), values[i]) > 0) {
 					result["total_count"] = 0;
 					error_code = protocol::ERRCODE_NOT_EXIST;
 					break;
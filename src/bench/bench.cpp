@@ -0,0 +1,438 @@
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <utils/headers.h>
+#include <common/general.h>
+#include <common/storage.h>
+#include <common/private_key.h>
+#include <ledger/ledger_manager.h>
+#include <ledger/ledger_frm.h>
+#include <ledger/transaction_frm.h>
+#include <ledger/kv_trie.h>
+#include <main/configure.h>
+
+//count every allocation of the process, a regression often shows up here first
+static std::atomic<int64_t> g_alloc_count(0);
+static std::atomic<int64_t> g_alloc_bytes(0);
+
+void *operator new(size_t size) {
+	g_alloc_count++;
+	g_alloc_bytes += size;
+	void *p = malloc(size == 0 ? 1 : size);
+	if (p == NULL) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void *p) noexcept {
+	free(p);
+}
+
+namespace bubi {
+
+	//latency samples of one operation, reported as throughput and percentiles.
+	//A batch timed at once is one sample of its mean time per operation, such rows report the percentiles of the batches
+	class BenchStat {
+	public:
+		BenchStat(const std::string &name) :name_(name), ops_(0), batched_(false), total_ns_(0), alloc_count_(0), alloc_bytes_(0) {}
+
+		void Begin() {
+			alloc_count_begin_ = g_alloc_count;
+			alloc_bytes_begin_ = g_alloc_bytes;
+			begin_ = std::chrono::steady_clock::now();
+		}
+
+		//ops is the number of operations timed since Begin
+		void End(int64_t ops = 1) {
+			int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin_).count();
+			alloc_count_ += g_alloc_count - alloc_count_begin_;
+			alloc_bytes_ += g_alloc_bytes - alloc_bytes_begin_;
+			total_ns_ += ns;
+			ops_ += ops;
+			batched_ = batched_ || ops > 1;
+			samples_.push_back(ns / ops);
+		}
+
+		void Report() {
+			if (samples_.empty()) {
+				return;
+			}
+
+			std::sort(samples_.begin(), samples_.end());
+			int64_t count = ops_;
+			std::string batches = batched_ ? utils::String::Format(" batches=" FMT_SIZE " mean/op of a batch:", samples_.size()) : "";
+			printf("%-24s ops=" FMT_I64 " ops/s=%.0f%s p50=%.2fus p90=%.2fus p99=%.2fus max=%.2fus allocs/op=%.1f bytes/op=%.0f\n",
+				name_.c_str(),
+				count,
+				total_ns_ > 0 ? count * 1e9 / total_ns_ : 0.0,
+				batches.c_str(),
+				Percentile(0.50) / 1e3,
+				Percentile(0.90) / 1e3,
+				Percentile(0.99) / 1e3,
+				samples_.back() / 1e3,
+				(double)alloc_count_ / count,
+				(double)alloc_bytes_ / count);
+		}
+
+	private:
+		std::string name_;
+		std::vector<int64_t> samples_;
+		int64_t ops_;
+		bool batched_;
+		std::chrono::steady_clock::time_point begin_;
+		int64_t total_ns_;
+		int64_t alloc_count_;
+		int64_t alloc_bytes_;
+		int64_t alloc_count_begin_;
+		int64_t alloc_bytes_begin_;
+
+		int64_t Percentile(double p) {
+			size_t index = (size_t)(p * (samples_.size() - 1));
+			return samples_[index];
+		}
+	};
+
+	//what CloseLedger does after the accounts are set
+	static void FlushTrie(KVTrie &trie, KeyValueDb *db) {
+		if (!db->WriteBatch(*trie.batch_)) {
+			BUBI_EXIT("Write batch failed(%s)", db->error_desc().c_str());
+		}
+		trie.batch_ = std::make_shared<WRITE_BATCH>();
+		trie.FreeMemory(4);
+	}
+
+	static const int64_t LEDGER_TX_COUNT = 1000;
+
+	void BenchTrie(int64_t count) {
+		MemoryDbDriver db;
+		KVTrie trie;
+		trie.Init(&db, std::make_shared<WRITE_BATCH>(), General::ACCOUNT_PREFIX, 4);
+
+		std::vector<std::string> keys(count);
+		for (int64_t i = 0; i < count; i++) {
+			keys[i] = HashWrapper::Crypto(utils::String::ToString(i)).substr(0, 23);
+		}
+		std::string value(120, 'v');
+
+		BenchStat set_stat("trie.set");
+		BenchStat hash_stat("trie.update_hash");
+		for (int64_t i = 0; i < count; i += LEDGER_TX_COUNT) {
+			int64_t end = MIN(count, i + LEDGER_TX_COUNT);
+			for (int64_t j = i; j < end; j++) {
+				set_stat.Begin();
+				trie.Set(keys[j], value);
+				set_stat.End();
+			}
+
+			hash_stat.Begin();
+			trie.UpdateHash();
+			hash_stat.End();
+			FlushTrie(trie, &db);
+		}
+
+		std::random_shuffle(keys.begin(), keys.end());
+		BenchStat get_stat("trie.get");
+		std::string read;
+		for (int64_t i = 0; i < count; i++) {
+			get_stat.Begin();
+			trie.Get(keys[i], read);
+			get_stat.End();
+		}
+
+		BenchStat delete_stat("trie.delete");
+		for (int64_t i = 0; i < count / 10; i++) {
+			delete_stat.Begin();
+			trie.Delete(keys[i]);
+			delete_stat.End();
+		}
+		trie.UpdateHash();
+		FlushTrie(trie, &db);
+
+		set_stat.Report();
+		hash_stat.Report();
+		get_stat.Report();
+		delete_stat.Report();
+	}
+
+	void BenchAccountAssets(int64_t count) {
+		PrivateKey key(SIGNTYPE_ED25519);
+		protocol::Account account;
+		account.set_address(key.GetBase16Address());
+		AccountFrm frm(account);
+
+		BenchStat set_stat("account.set_asset");
+		BenchStat hash_stat("account.update_hash");
+		const int64_t asset_kinds = 100;
+		for (int64_t i = 0; i < count; i += asset_kinds) {
+			for (int64_t j = 0; j < asset_kinds; j++) {
+				protocol::Asset asset;
+				asset.mutable_property()->set_issuer(account.address());
+				asset.mutable_property()->set_code(utils::String::Format("A" FMT_I64, j));
+				asset.set_amount(i + j);
+
+				set_stat.Begin();
+				frm.SetAsset(asset);
+				set_stat.End();
+			}
+
+			std::shared_ptr<WRITE_BATCH> batch = std::make_shared<WRITE_BATCH>();
+			hash_stat.Begin();
+			frm.UpdateHash(batch);
+			hash_stat.End();
+			Storage::Instance().account_db()->WriteBatch(*batch);
+		}
+
+		set_stat.Report();
+		hash_stat.Report();
+	}
+
+	static protocol::TransactionEnv SignTransaction(const PrivateKey &key, const protocol::Transaction &tx) {
+		protocol::TransactionEnv env;
+		*env.mutable_transaction() = tx;
+		protocol::Signature *signature = env.add_signatures();
+		signature->set_public_key(key.GetBase16PublicKey());
+		signature->set_sign_data(key.Sign(tx.SerializeAsString()));
+		return env;
+	}
+
+	//alternates payments between funded accounts and new account creations
+	static void BuildTxSet(const std::vector<std::shared_ptr<PrivateKey>> &sources, std::vector<int64_t> &nonces,
+		int64_t count, protocol::ConsensusValue &value) {
+		for (int64_t i = 0; i < count; i++) {
+			size_t index = (size_t)(i % sources.size());
+			const PrivateKey &source = *sources[index];
+
+			protocol::Transaction tx;
+			tx.set_source_address(source.GetBase16Address());
+			tx.set_nonce(++nonces[index]);
+			protocol::Operation *ope = tx.add_operations();
+			if (i % 2 == 0) {
+				ope->set_type(protocol::Operation_Type_PAYMENT);
+				protocol::OperationPayment *payment = ope->mutable_payment();
+				payment->set_dest_address(sources[(index + 1) % sources.size()]->GetBase16Address());
+				payment->mutable_asset()->mutable_property()->set_issuer(source.GetBase16Address());
+				payment->mutable_asset()->mutable_property()->set_code("BNC");
+				payment->mutable_asset()->set_amount(1);
+			}
+			else {
+				PrivateKey dest(SIGNTYPE_ED25519);
+				ope->set_type(protocol::Operation_Type_CREATE_ACCOUNT);
+				protocol::OperationCreateAccount *create = ope->mutable_create_account();
+				create->set_dest_address(dest.GetBase16Address());
+				create->set_init_balance(1000);
+				create->mutable_priv()->set_master_weight(1);
+				create->mutable_priv()->mutable_thresholds()->set_tx_threshold(1);
+			}
+			*value.mutable_txset()->add_txs() = SignTransaction(source, tx);
+		}
+	}
+
+	static void CreateSources(size_t count, std::vector<std::shared_ptr<PrivateKey>> &sources, std::vector<int64_t> &nonces) {
+		KVTrie *tree = LedgerManager::Instance().tree_;
+		std::shared_ptr<WRITE_BATCH> batch = tree->batch_;
+		for (size_t i = 0; i < count; i++) {
+			std::shared_ptr<PrivateKey> key = std::make_shared<PrivateKey>(SIGNTYPE_ED25519);
+			protocol::Account account;
+			account.set_address(key->GetBase16Address());
+			account.set_balance(100000000000000000);
+			AccountFrm frm(account);
+			frm.SetProtoMasterWeight(1);
+			frm.SetProtoTxThreshold(1);
+
+			protocol::Asset asset;
+			asset.mutable_property()->set_issuer(account.address());
+			asset.mutable_property()->set_code("BNC");
+			asset.set_amount(100000000000000000);
+			frm.SetAsset(asset);
+			frm.UpdateHash(batch);
+
+			tree->Set(utils::String::HexStringToBin(account.address()), frm.Serializer());
+			sources.push_back(key);
+			nonces.push_back(0);
+		}
+		tree->UpdateHash();
+		FlushTrie(*tree, Storage::Instance().account_db());
+	}
+
+	void BenchLedgerApply(int64_t count) {
+		std::vector<std::shared_ptr<PrivateKey>> sources;
+		std::vector<int64_t> nonces;
+		CreateSources(100, sources, nonces);
+
+		KVTrie *tree = LedgerManager::Instance().tree_;
+		BenchStat apply_stat("ledger.apply");
+		BenchStat commit_stat("ledger.commit_hash");
+		for (int64_t i = 0; i < count; i += LEDGER_TX_COUNT) {
+			protocol::ConsensusValue value;
+			int64_t tx_count = MIN(LEDGER_TX_COUNT, count - i);
+			BuildTxSet(sources, nonces, tx_count, value);
+
+			LedgerFrm ledger;
+			apply_stat.Begin();
+			ledger.Apply(value);
+			apply_stat.End(tx_count);
+
+			int64_t new_count = 0, change_count = 0;
+			commit_stat.Begin();
+			ledger.Commit(tree, new_count, change_count);
+			tree->UpdateHash();
+			commit_stat.End(tx_count);
+			FlushTrie(*tree, Storage::Instance().account_db());
+
+			if (ledger.GetTxCount() != (size_t)tx_count) {
+				LOG_ERROR("Applied " FMT_SIZE " of " FMT_I64 " transactions", ledger.GetTxCount(), tx_count);
+			}
+		}
+
+		apply_stat.Report();
+		commit_stat.Report();
+	}
+
+	//trie leaves are a few hundred bytes, hashed one by one and 8 lanes at a time
+	void BenchHash(int64_t count) {
+		std::vector<std::string> leaves(count);
+		std::vector<const std::string *> inputs(count);
+		for (int64_t i = 0; i < count; i++) {
+			leaves[i] = std::string(100 + i % 200, (char)i);
+			inputs[i] = &leaves[i];
+		}
+
+		BenchStat single_stat("hash.single");
+		std::string hash;
+		for (int64_t i = 0; i < count; i++) {
+			single_stat.Begin();
+			HashWrapper::Crypto(leaves[i], hash);
+			single_stat.End();
+		}
+
+		BenchStat multi_stat("hash.multi");
+		std::vector<std::string> hashes;
+		const int64_t slice_size = 1000;
+		for (int64_t i = 0; i < count; i += slice_size) {
+			std::vector<const std::string *> slice(inputs.begin() + i, inputs.begin() + std::min(count, i + slice_size));
+			multi_stat.Begin();
+			HashWrapper::CryptoMulti(slice, hashes);
+			multi_stat.End(slice.size());
+		}
+
+		single_stat.Report();
+		multi_stat.Report();
+	}
+
+	//sm3 one by one and 8 lanes at a time, test_sm3 checks that they agree
+	void BenchSm3(int64_t count) {
+		std::vector<std::string> leaves(count);
+		std::vector<const std::string *> inputs(count);
+		for (int64_t i = 0; i < count; i++) {
+			leaves[i] = std::string(100 + i % 200, (char)i);
+			inputs[i] = &leaves[i];
+		}
+
+		BenchStat single_stat("sm3.single");
+		std::string hash;
+		for (int64_t i = 0; i < count; i++) {
+			single_stat.Begin();
+			utils::Sm3::Crypto(leaves[i], hash);
+			single_stat.End();
+		}
+
+		BenchStat multi_stat("sm3.multi");
+		std::vector<std::string> hashes;
+		const int64_t slice_size = 1000;
+		for (int64_t i = 0; i < count; i += slice_size) {
+			std::vector<const std::string *> slice(inputs.begin() + i, inputs.begin() + std::min(count, i + slice_size));
+			multi_stat.Begin();
+			utils::Sm3::CryptoMulti(slice, hashes);
+			multi_stat.End(slice.size());
+		}
+
+		single_stat.Report();
+		multi_stat.Report();
+	}
+
+	void BenchTransaction(int64_t count) {
+		PrivateKey key(SIGNTYPE_ED25519);
+		std::vector<protocol::TransactionEnv> envs;
+		for (int64_t i = 0; i < count; i++) {
+			protocol::Transaction tx;
+			tx.set_source_address(key.GetBase16Address());
+			tx.set_nonce(i + 1);
+			protocol::Operation *ope = tx.add_operations();
+			ope->set_type(protocol::Operation_Type_PAYMENT);
+			ope->mutable_payment()->set_dest_address(key.GetBase16Address());
+			envs.push_back(SignTransaction(key, tx));
+		}
+
+		//the constructor hashes the transaction and verifies its signatures
+		BenchStat verify_stat("transaction.construct");
+		BenchStat param_stat("transaction.check_param");
+		for (int64_t i = 0; i < count; i++) {
+			verify_stat.Begin();
+			TransactionFrm frm(envs[i]);
+			verify_stat.End();
+
+			param_stat.Begin();
+			frm.ValidForParameter();
+			param_stat.End();
+		}
+
+		verify_stat.Report();
+		param_stat.Report();
+	}
+}
+
+int main(int argc, char *argv[]) {
+	utils::Thread::SetCurrentThreadName("bubi-bench");
+	utils::Timer::InitInstance();
+	bubi::Configure::InitInstance();
+	bubi::Storage::InitInstance();
+	bubi::Global::InitInstance();
+	utils::Logger::InitInstance();
+	bubi::LedgerManager::InitInstance();
+
+	std::string name = argc > 1 ? argv[1] : "all";
+	int64_t count = argc > 2 ? utils::String::Stoi64(argv[2]) : 100000;
+	int64_t threads = argc > 3 ? utils::String::Stoi64(argv[3]) : 0;
+	if (count <= 0 || threads < 0 || (name != "all" && name != "trie" && name != "account" && name != "apply" && name != "tx" && name != "hash" && name != "sm3")) {
+		printf("Usage: bubi_bench [all|trie|account|apply|tx|hash|sm3] [count, default 100000] [apply threads, default 0 for the cpu cores]\n");
+		return 1;
+	}
+
+	utils::Logger::Instance().Initialize(utils::LOG_DEST_OUT, utils::LOG_LEVEL_ERROR, "", false);
+
+	//everything stays in memory, the numbers measure cpu and allocations only
+	bubi::DbConfigure db_config;
+	db_config.key_value_db_type_ = "memory";
+	if (!bubi::Storage::Instance().Initialize(db_config, false)) {
+		printf("Initialize storage failed\n");
+		return 1;
+	}
+	bubi::HashWrapper::SetLedgerHashType(bubi::Configure::Instance().ledger_configure_.hash_type_);
+
+	bubi::LedgerManager &ledger_manager = bubi::LedgerManager::Instance();
+	ledger_manager.tree_ = new bubi::KVTrie();
+	ledger_manager.tree_->Init(bubi::Storage::Instance().account_db(), std::make_shared<WRITE_BATCH>(), bubi::General::ACCOUNT_PREFIX, 4);
+
+	//the apply pool as LedgerManager::Initialize sets it up, it runs the parallel apply and the trie hashing
+	ledger_manager.apply_thread_count_ = threads > 0 ? (uint32_t)threads : utils::System::GetCpuCoreCount();
+	if (ledger_manager.apply_thread_count_ > 1) {
+		if (!ledger_manager.apply_pool_.Init("apply", ledger_manager.apply_thread_count_)) {
+			printf("Start apply thread pool failed\n");
+			return 1;
+		}
+		ledger_manager.tree_->SetThreadPool(&ledger_manager.apply_pool_);
+	}
+	printf("apply threads: %u\n", ledger_manager.apply_thread_count_);
+
+	if (name == "all" || name == "trie") bubi::BenchTrie(count);
+	if (name == "all" || name == "account") bubi::BenchAccountAssets(count);
+	if (name == "all" || name == "apply") bubi::BenchLedgerApply(count);
+	if (name == "all" || name == "tx") bubi::BenchTransaction(count);
+	if (name == "all" || name == "hash") bubi::BenchHash(count);
+	if (name == "all" || name == "sm3") bubi::BenchSm3(count);
+
+	ledger_manager.apply_pool_.Exit();
+	bubi::Storage::Instance().Exit();
+	return 0;
+}
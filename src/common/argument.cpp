@@ -12,7 +12,8 @@ namespace bubi {
 		peer_addr_(false),
 		clear_peer_addresses_(false),
 		clear_consensus_status_(false),
-		create_hardfork_(false){}
+		create_hardfork_(false),
+		replay_end_seq_(0){}
 	Argument::~Argument() {}
 
 	bool Argument::Parse(int argc, char *argv[]) {
@@ -77,6 +78,10 @@ namespace bubi {
 			else if (s == "--create-hardfork") {
 				create_hardfork_ = true;
 			}
+			else if (s == "--replay" && argc > 2) {
+				replay_path_ = argv[2];
+				replay_end_seq_ = argc > 3 ? utils::String::Stoi64(argv[3]) : 0;
+			}
 			else if (s == "--version") {
 #ifdef SVNVERSION
 				printf("%s,%u; " SVNVERSION "\n", General::BUBI_VERSION, General::LEDGER_VERSION);
@@ -131,14 +136,10 @@ namespace bubi {
 				char ch;
 				std::cin >> ch;
 				if (ch == '1'){
-#ifdef WIN32
-					auto it = (leveldb::Iterator*)ledger_db_->NewIterator();
-#else
-					auto it = (rocksdb::Iterator*)ledger_db_->NewIterator();
-#endif
-					for (it->SeekToFirst(); it->Valid(); it->Next()){
-						printf("%s:%s\n", utils::String::BinToHexString(it->key().ToString()).c_str(),
-							utils::String::BinToHexString(it->value().ToString()).c_str());
+					KeyValueDbIteratorPtr it = ledger_db_->NewIterator();
+					for (; it->Valid(); it->Next()){
+						printf("%s:%s\n", utils::String::BinToHexString(it->key()).c_str(),
+							utils::String::BinToHexString(it->value()).c_str());
 					}
 				}
 				else if (ch == '2')
@@ -181,6 +182,7 @@ namespace bubi {
 			"  --aes-crypto <value>            crypto value\n"
 			"  --version                       display version information\n"
 			"  --create-hardfork               create hard fork ledger\n"
+			"  --replay <ledger-db> [end-seq]  re-execute the ledgers of a ledger db copy\n"
 			"  --clear-peer-addresses          clear peer list\n"
 			"  --help                          display this help\n"
 			);
@@ -17,6 +17,8 @@ namespace bubi {
 		bool clear_peer_addresses_;
 		bool clear_consensus_status_;
 		bool create_hardfork_;
+		std::string replay_path_; //a copy of the ledger db to re-execute
+		int64_t replay_end_seq_;
 
 		bool Parse(int argc, char *argv[]);
 		void Usage();
@@ -5,6 +5,56 @@
 #include "configure_base.h"
 
 namespace bubi {
+	KeyValueDbConfigure::KeyValueDbConfigure() {
+		bloom_bits_ = 10;
+		prefix_length_ = 0;
+		block_size_ = 4;
+		write_buffer_size_ = 64;
+		max_write_buffer_number_ = 3;
+		max_background_compactions_ = 2;
+		max_background_flushes_ = 1;
+		max_open_files_ = 5000;
+	}
+
+	KeyValueDbConfigure::~KeyValueDbConfigure() {}
+
+	bool KeyValueDbConfigure::Load(const Json::Value &value) {
+		ConfigureBase::GetValue(value, "bloom_bits", bloom_bits_);
+		ConfigureBase::GetValue(value, "prefix_length", prefix_length_);
+		ConfigureBase::GetValue(value, "block_size", block_size_);
+		ConfigureBase::GetValue(value, "write_buffer_size", write_buffer_size_);
+		ConfigureBase::GetValue(value, "max_write_buffer_number", max_write_buffer_number_);
+		ConfigureBase::GetValue(value, "compression", compression_);
+		ConfigureBase::GetValue(value, "max_background_compactions", max_background_compactions_);
+		ConfigureBase::GetValue(value, "max_background_flushes", max_background_flushes_);
+		ConfigureBase::GetValue(value, "max_open_files", max_open_files_);
+
+		//a misspelled name must not leave a level uncompressed without a word
+		for (utils::StringList::const_iterator iter = compression_.begin(); iter != compression_.end(); iter++) {
+			if (*iter != "none" && *iter != "snappy" && *iter != "zlib" && *iter != "bzip2" && *iter != "lz4" && *iter != "lz4hc") {
+				LOG_STD_ERR("Unknown db compression(%s), expect none/snappy/zlib/bzip2/lz4/lz4hc", iter->c_str());
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void KeyValueDbConfigure::ToJson(Json::Value &value) const {
+		value["bloom_bits"] = bloom_bits_;
+		value["prefix_length"] = prefix_length_;
+		value["block_size"] = block_size_;
+		value["write_buffer_size"] = write_buffer_size_;
+		value["max_write_buffer_number"] = max_write_buffer_number_;
+		Json::Value &compression = value["compression"];
+		compression = Json::Value(Json::arrayValue);
+		for (utils::StringList::const_iterator iter = compression_.begin(); iter != compression_.end(); iter++) {
+			compression.append(*iter);
+		}
+		value["max_background_compactions"] = max_background_compactions_;
+		value["max_background_flushes"] = max_background_flushes_;
+		value["max_open_files"] = max_open_files_;
+	}
+
 	DbConfigure::DbConfigure() {
 		keyvalue_db_path_ = General::DEFAULT_KEYVALUE_DB_PATH;
 		ledger_db_path_ = General::DEFAULT_LEDGER_DB_PATH;
@@ -12,6 +62,7 @@ namespace bubi {
 		tmp_path_ = "tmp";
 		async_write_sql_ = false; //default sync write sql
 		async_write_kv_ = false; //default sync write kv
+		block_cache_size_ = 256;
 	}
 
 	DbConfigure::~DbConfigure() {}
@@ -20,12 +71,20 @@ namespace bubi {
 		ConfigureBase::GetValue(value, "keyvalue_path", keyvalue_db_path_);
 		ConfigureBase::GetValue(value, "ledger_path", ledger_db_path_);
 		ConfigureBase::GetValue(value, "account_path", account_db_path_);
+		ConfigureBase::GetValue(value, "column_family_path", column_family_db_path_);
+		ConfigureBase::GetValue(value, "key_value_db_type", key_value_db_type_);
 		
 		ConfigureBase::GetValue(value, "rational_string", rational_string_);
 		ConfigureBase::GetValue(value, "rational_db_type", rational_db_type_);
 		ConfigureBase::GetValue(value, "tmp_path", tmp_path_);
 		ConfigureBase::GetValue(value, "async_write_sql", async_write_sql_);
 		ConfigureBase::GetValue(value, "async_write_kv", async_write_kv_);
+		ConfigureBase::GetValue(value, "block_cache_size", block_cache_size_);
+		if (!keyvalue_options_.Load(value["keyvalue_options"]) ||
+			!ledger_options_.Load(value["ledger_options"]) ||
+			!account_options_.Load(value["account_options"])) {
+			return false;
+		}
 
 
 		std::string rational_decode;
@@ -55,6 +114,10 @@ namespace bubi {
 			account_db_path_ = utils::String::Format("%s/%s", utils::File::GetBinHome().c_str(), account_db_path_.c_str());
 		}
 
+		if (!column_family_db_path_.empty() && !utils::File::IsAbsolute(column_family_db_path_)) {
+			column_family_db_path_ = utils::String::Format("%s/%s", utils::File::GetBinHome().c_str(), column_family_db_path_.c_str());
+		}
+
 		if (!utils::File::IsAbsolute(tmp_path_)) {
 			tmp_path_ = utils::String::Format("%s/%s", utils::File::GetBinHome().c_str(), tmp_path_.c_str());
 		}
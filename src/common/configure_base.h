@@ -26,6 +26,25 @@ namespace bubi {
 		bool Load(const Json::Value &value);
 	};
 
+	//rocksdb tuning of one db, ignored by leveldb
+	class KeyValueDbConfigure {
+	public:
+		KeyValueDbConfigure();
+		~KeyValueDbConfigure();
+
+		uint32_t bloom_bits_; //bits per key of the sst bloom filter, 0: no filter
+		uint32_t prefix_length_; //key prefix of the prefix bloom filters, 0: whole key filter only
+		uint32_t block_size_; //KB
+		uint32_t write_buffer_size_; //MB
+		uint32_t max_write_buffer_number_;
+		utils::StringList compression_; //per level, none/snappy/zlib/bzip2/lz4/lz4hc, empty: rocksdb default
+		uint32_t max_background_compactions_;
+		uint32_t max_background_flushes_;
+		int32_t max_open_files_;
+		bool Load(const Json::Value &value);
+		void ToJson(Json::Value &value) const;
+	};
+
 	class DbConfigure {
 	public:
 		DbConfigure();
@@ -34,11 +53,17 @@ namespace bubi {
 		std::string keyvalue_db_path_;
 		std::string ledger_db_path_;
 		std::string account_db_path_;
+		std::string column_family_db_path_; //not empty: the dbs above are column families of this one
+		std::string key_value_db_type_; //memory: keep the dbs above in process memory, empty: on disk
 		std::string rational_string_;
 		std::string rational_db_type_;
 		std::string tmp_path_;
 		bool async_write_sql_;
 		bool async_write_kv_;
+		uint32_t block_cache_size_; //MB, one lru cache shared by all dbs, 0: rocksdb default cache per db
+		KeyValueDbConfigure keyvalue_options_;
+		KeyValueDbConfigure ledger_options_;
+		KeyValueDbConfigure account_options_;
 		bool Load(const Json::Value &value);
 	};
 
@@ -281,6 +281,15 @@ namespace bubi {
 		}
 	}
 
+	void HashWrapper::CryptoMulti(const std::vector<const std::string *> &inputs, std::vector<std::string> &outputs){
+		if (ledger_type_ == HASH_TYPE_SM3){
+			utils::Sm3::CryptoMulti(inputs, outputs);
+		}
+		else{
+			utils::Sha256::CryptoMulti(inputs, outputs);
+		}
+	}
+
 	std::string ComposePrefix(const std::string &prefix, const std::string &value) {
 		std::string result = prefix;
 		result += "_";
@@ -242,6 +242,8 @@ namespace bubi {
 		static std::string Crypto(const std::string &input);
 		static void Crypto(unsigned char* str, int len, unsigned char *buf);
 		static void Crypto(const std::string &input, std::string &str);
+		//hashes many small inputs at once, see utils::Sha256::CryptoMulti and utils::Sm3::CryptoMulti
+		static void CryptoMulti(const std::vector<const std::string *> &inputs, std::vector<std::string> &outputs);
 	};
 
 	std::string GetDataSecuretKey();
@@ -6,6 +6,7 @@
 #include <utils/crypto.h>
 #include <utils/sm3.h>
 #include <utils/strings.h>
+#include <utils/lrucache.hpp>
 #include "general.h"
 #include "private_key.h"
 #include "cfca.h"
@@ -132,20 +133,92 @@ namespace bubi {
 		return SIGNTYPE_NONE;
 	}
 
+	//the id every sm2 signature of the chain is made with
+	static const char *SM2_USER_ID = "1234567812345678";
+
+	//parsed public keys by their base16 form. Validators and active signers come back with every
+	//message, so the hex decoding, the address hash and the sm2 point and ZA are paid once per key
+	class PublicKeyCache {
+	public:
+		struct Entry {
+			SignatureType type_;
+			std::string raw_pub_key_;
+			std::string address_;
+			std::string sm2_za_;
+			std::shared_ptr<EC_POINT> sm2_point_;
+		};
+		typedef std::shared_ptr<const Entry> EntryPointer;
+
+		static PublicKeyCache &Instance() {
+			static PublicKeyCache cache(10240);
+			return cache;
+		}
+
+		//NULL when the string is not a valid public key, those are never cached
+		EntryPointer Get(const std::string &base16_pub_key) {
+			Shard &shard = *shards_[std::hash<std::string>()(base16_pub_key) % SHARD_COUNT];
+			EntryPointer entry;
+			do {
+				utils::MutexGuard guard(shard.mutex_);
+				if (shard.entries_.get(base16_pub_key, entry)) {
+					return entry;
+				}
+			} while (false);
+
+			PrivateKeyPrefix prefix;
+			PublicKey key;
+			if (!GetKeyElement(base16_pub_key, prefix, key.type_, key.raw_pub_key_) || prefix != PUBLICKEY_PREFIX) {
+				return NULL;
+			}
+
+			std::shared_ptr<Entry> new_entry = std::make_shared<Entry>();
+			new_entry->type_ = key.type_;
+			new_entry->raw_pub_key_ = key.raw_pub_key_;
+			new_entry->address_ = key.GetBase16Address();
+			if (key.type_ == SIGNTYPE_CFCASM2) {
+				EC_GROUP *group = utils::EccSm2::GetCFCAGroup();
+				new_entry->sm2_point_.reset(utils::EccSm2::NewPublicKeyPoint(group, key.raw_pub_key_), EC_POINT_free);
+				new_entry->sm2_za_ = utils::EccSm2::getZA(group, SM2_USER_ID, new_entry->sm2_point_.get());
+			}
+
+			utils::MutexGuard guard(shard.mutex_);
+			shard.entries_.put(base16_pub_key, new_entry);
+			return new_entry;
+		}
+
+	private:
+		static const size_t SHARD_COUNT = 16;
+		struct Shard {
+			Shard(size_t max_count) :entries_(max_count) {}
+			cache::lru_cache<std::string, EntryPointer> entries_;
+			utils::Mutex mutex_;
+		};
+		std::vector<std::shared_ptr<Shard>> shards_;
+
+		PublicKeyCache(size_t max_count) {
+			for (size_t i = 0; i < SHARD_COUNT; i++) {
+				shards_.push_back(std::make_shared<Shard>(max_count / SHARD_COUNT + 1));
+			}
+		}
+	};
+
 	PublicKey::PublicKey() :valid_(false), type_(SIGNTYPE_RSA) {}
 
 	PublicKey::~PublicKey() {}
 
-	PublicKey::PublicKey(const std::string &base16_pub_key) {
-		do {
-			PrivateKeyPrefix prefix;
-			valid_ = GetKeyElement(base16_pub_key, prefix, type_, raw_pub_key_);
-			valid_ = (prefix == PUBLICKEY_PREFIX);
-		} while (false);
+	PublicKey::PublicKey(const std::string &base16_pub_key) :valid_(false), type_(SIGNTYPE_NONE) {
+		PublicKeyCache::EntryPointer entry = PublicKeyCache::Instance().Get(base16_pub_key);
+		if (entry) {
+			valid_ = true;
+			type_ = entry->type_;
+			raw_pub_key_ = entry->raw_pub_key_;
+			address_ = entry->address_;
+		}
 	}
 
 	void PublicKey::Init(std::string rawpkey) {
 		raw_pub_key_ = rawpkey;
+		address_.clear();
 	}
 
 	bool PublicKey::IsAddressValid(const std::string &address_base16) {
@@ -182,6 +255,10 @@ namespace bubi {
 	}
 
 	std::string PublicKey::GetBase16Address() const {
+		if (!address_.empty()) {
+			return address_;
+		}
+
 		//append prefix
 		std::string str_result = "";
 		str_result.push_back((char)ADDRESS_PREFIX);
@@ -217,20 +294,58 @@ namespace bubi {
 		return utils::String::BinToHexString(str_result);
 	}
 
+	void PublicKey::VerifyBatch(const std::vector<VerifyItem> &items, std::vector<bool> &valids) {
+		valids.assign(items.size(), false);
+
+		std::vector<size_t> indexes;
+		std::vector<std::string> raw_pubkeys;
+		for (size_t i = 0; i < items.size(); i++) {
+			const VerifyItem &item = items[i];
+			PublicKeyCache::EntryPointer entry = PublicKeyCache::Instance().Get(*item.public_key_);
+			if (entry && entry->type_ == SIGNTYPE_ED25519 && entry->raw_pub_key_.size() == ED25519_PUBLICKEY_LENGTH && item.signature_->size() == 64) {
+				indexes.push_back(i);
+				raw_pubkeys.push_back(entry->raw_pub_key_);
+				continue;
+			}
+			valids[i] = Verify(*item.data_, *item.signature_, *item.public_key_);
+		}
+
+		if (indexes.empty()) {
+			return;
+		}
+
+		std::vector<const unsigned char *> messages(indexes.size());
+		std::vector<size_t> message_lens(indexes.size());
+		std::vector<const unsigned char *> pubkeys(indexes.size());
+		std::vector<const unsigned char *> signatures(indexes.size());
+		std::vector<int> results(indexes.size());
+		for (size_t i = 0; i < indexes.size(); i++) {
+			const VerifyItem &item = items[indexes[i]];
+			messages[i] = (const unsigned char *)item.data_->c_str();
+			message_lens[i] = item.data_->size();
+			pubkeys[i] = (const unsigned char *)raw_pubkeys[i].c_str();
+			signatures[i] = (const unsigned char *)item.signature_->c_str();
+		}
+
+		ed25519_sign_open_batch(&messages[0], &message_lens[0], &pubkeys[0], &signatures[0], indexes.size(), &results[0]);
+		for (size_t i = 0; i < indexes.size(); i++) {
+			valids[indexes[i]] = results[i] == 1;
+		}
+	}
+
 	bool PublicKey::Verify(const std::string &data, const std::string &signature, const std::string &public_key_base16) {
-		PrivateKeyPrefix prefix;
-		SignatureType sign_type;
-		std::string raw_pubkey;
-		bool valid = GetKeyElement(public_key_base16, prefix, sign_type, raw_pubkey);
-		if (!valid || prefix != PUBLICKEY_PREFIX) {
+		PublicKeyCache::EntryPointer entry = PublicKeyCache::Instance().Get(public_key_base16);
+		if (!entry) {
 			return false;
-		} 
+		}
+		SignatureType sign_type = entry->type_;
+		const std::string &raw_pubkey = entry->raw_pub_key_;
 
 		if (sign_type == SIGNTYPE_ED25519 ) {
 			return ed25519_sign_open((unsigned char *)data.c_str(), data.size(), (unsigned char *)raw_pubkey.c_str(), (unsigned char *)signature.c_str()) == 0;
 		}
 		else if (sign_type == SIGNTYPE_CFCASM2) {
-			return utils::EccSm2::verify(utils::EccSm2::GetCFCAGroup(), raw_pubkey, "1234567812345678", data, signature) == 1;
+			return utils::EccSm2::verifyZA(utils::EccSm2::GetCFCAGroup(), entry->sm2_point_.get(), entry->sm2_za_, data, signature) == 1;
 		}
 		else if (sign_type == SIGNTYPE_RSA) {
 			bool result = false;
@@ -380,7 +495,7 @@ namespace bubi {
 			utils::EccSm2 key(utils::EccSm2::GetCFCAGroup());
 			key.From(raw_priv_key_);
 			std::string r, s;
-			return key.Sign("1234567812345678", input);
+			return key.Sign(SM2_USER_ID, input);
 		}
 		else if (type_ == SIGNTYPE_RSA) {
 			const unsigned char *key_cstr = (const unsigned char *)raw_priv_key_.c_str();
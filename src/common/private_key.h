@@ -39,9 +39,12 @@ namespace bubi {
 	std::string GetSignTypeDesc(SignatureType type);
 	SignatureType GetSignTypeByDesc(const std::string &desc);
 
+	class PublicKeyCache;
+
 	class PublicKey {
 		DISALLOW_COPY_AND_ASSIGN(PublicKey);
 		friend class PrivateKey;
+		friend class PublicKeyCache;
 
 	public:
 		PublicKey();
@@ -64,11 +67,23 @@ namespace bubi {
 		std::string CalcHash(const std::string &value) const;
 
 		static bool Verify(const std::string &data, const std::string &signature, const std::string &public_key_base16);
+
+		//one signature of VerifyBatch, the strings must outlive the call
+		struct VerifyItem {
+			const std::string *data_;
+			const std::string *signature_;
+			const std::string *public_key_;
+		};
+		//checks the ed25519 items in one ed25519_sign_open_batch call, which checks a failed batch one by one, and the others with Verify.
+		//A batch may accept a signature with a small order component that Verify rejects, so filter with it but never decide a ledger
+		static void VerifyBatch(const std::vector<VerifyItem> &items, std::vector<bool> &valids);
 		static bool IsAddressValid(const std::string &public_key_base16);
 	private:
 		std::string raw_pub_key_;
 		bool valid_;
 		SignatureType type_;
+		//filled from the parse cache by the base16 constructor, GetBase16Address hashes the key when empty
+		std::string address_;
 	};
 
 	class PrivateKey {
@@ -5,12 +5,216 @@
 #include <utils/file.h>
 #include "storage.h"
 #include "general.h"
+#ifndef WIN32
+#include <rocksdb/table.h>
+#include <rocksdb/filter_policy.h>
+#include <rocksdb/slice_transform.h>
+#endif
 
 namespace bubi {
 	KeyValueDb::KeyValueDb() {}
 
 	KeyValueDb::~KeyValueDb() {}
 
+	class StagedKeyCollector : public WRITE_BATCH::Handler {
+		const WRITE_BATCH *batch_;
+		std::vector<std::string> &keys_;
+		std::unordered_map<std::string, KeyValueDb::StagedValue> &overlay_;
+	public:
+		StagedKeyCollector(const WRITE_BATCH *batch, std::vector<std::string> &keys, std::unordered_map<std::string, KeyValueDb::StagedValue> &overlay)
+			:batch_(batch), keys_(keys), overlay_(overlay) {}
+
+		virtual void Put(const SLICE& key, const SLICE& value) override {
+			KeyValueDb::StagedValue &staged = overlay_[key.ToString()];
+			staged.owner_ = batch_;
+			staged.deleted_ = false;
+			staged.value_ = value.ToString();
+			keys_.push_back(key.ToString());
+		}
+
+		virtual void Delete(const SLICE& key) override {
+			KeyValueDb::StagedValue &staged = overlay_[key.ToString()];
+			staged.owner_ = batch_;
+			staged.deleted_ = true;
+			staged.value_.clear();
+			keys_.push_back(key.ToString());
+		}
+	};
+
+	void KeyValueDb::Stage(std::shared_ptr<WRITE_BATCH> batch) {
+		utils::MutexGuard guard(staged_mutex_);
+		StagedBatch staged;
+		staged.batch_ = batch;
+		StagedKeyCollector collector(batch.get(), staged.keys_, overlay_);
+		batch->Iterate(&collector);
+		staged_.push_back(staged);
+	}
+
+	bool KeyValueDb::WriteStaged() {
+		std::shared_ptr<WRITE_BATCH> batch = FrontStaged();
+		if (!batch) {
+			return true;
+		}
+
+		//the overlay keeps serving the batch until it is in the db
+		if (!WriteBatch(*batch)) {
+			return false;
+		}
+		PopStaged();
+		return true;
+	}
+
+	std::shared_ptr<WRITE_BATCH> KeyValueDb::FrontStaged() {
+		utils::MutexGuard guard(staged_mutex_);
+		if (staged_.empty()) {
+			return NULL;
+		}
+		return staged_.front().batch_;
+	}
+
+	void KeyValueDb::PopStaged() {
+		utils::MutexGuard guard(staged_mutex_);
+		if (staged_.empty()) {
+			return;
+		}
+
+		const StagedBatch &staged = staged_.front();
+		for (size_t i = 0; i < staged.keys_.size(); i++) {
+			auto iter = overlay_.find(staged.keys_[i]);
+			if (iter != overlay_.end() && iter->second.owner_ == staged.batch_.get()) {
+				overlay_.erase(iter);
+			}
+		}
+		staged_.pop_front();
+	}
+
+	KeyValueDbIteratorPtr KeyValueDb::NewIterator(const KeyValueDbIterator::Options &options) {
+		std::string upper_bound = KeyValueDbIterator::PrefixEnd(options.prefix_);
+		if (!options.upper_bound_.empty() && (upper_bound.empty() || options.upper_bound_ < upper_bound)) {
+			upper_bound = options.upper_bound_;
+		}
+
+		//copy the staged keys before the engine iterator pins its view,
+		//a batch written in between is then seen twice with the same value rather than missed
+		KeyValueDbIterator::StagedMap staged;
+		do {
+			utils::MutexGuard guard(staged_mutex_);
+			for (auto iter = overlay_.begin(); iter != overlay_.end(); iter++) {
+				const std::string &key = iter->first;
+				if (key.compare(0, options.prefix_.size(), options.prefix_) != 0 ||
+					(!upper_bound.empty() && key >= upper_bound)) {
+					continue;
+				}
+				KeyValueDbIterator::StagedEntry &entry = staged[key];
+				entry.deleted_ = iter->second.deleted_;
+				entry.value_ = iter->second.value_;
+			}
+		} while (false);
+
+		return KeyValueDbIteratorPtr(new KeyValueDbIterator(NewDbIterator(options.fill_cache_), options.prefix_, upper_bound, staged));
+	}
+
+	KeyValueDbIterator::KeyValueDbIterator(KVDB::Iterator *iter, const std::string &lower_bound, const std::string &upper_bound, StagedMap &staged)
+		:iter_(iter), upper_bound_(upper_bound), valid_(false) {
+		staged_.swap(staged);
+		staged_iter_ = staged_.begin();
+		iter_->Seek(lower_bound);
+		Settle();
+	}
+
+	KeyValueDbIterator::~KeyValueDbIterator() {
+		delete iter_;
+	}
+
+	std::string KeyValueDbIterator::PrefixEnd(const std::string &prefix) {
+		std::string end = prefix;
+		while (!end.empty()) {
+			unsigned char last = (unsigned char)end[end.size() - 1];
+			if (last != 0xff) {
+				end[end.size() - 1] = (char)(last + 1);
+				return end;
+			}
+			end.resize(end.size() - 1);
+		}
+		return end;
+	}
+
+	bool KeyValueDbIterator::DbValid() const {
+		return iter_->Valid() && (upper_bound_.empty() || iter_->key().compare(SLICE(upper_bound_)) < 0);
+	}
+
+	//move key_ and value_ to the smallest key of the db and the staged keys, the staged value wins a tie
+	void KeyValueDbIterator::Settle() {
+		while (true) {
+			bool db_valid = DbValid();
+			bool staged_valid = staged_iter_ != staged_.end();
+			if (!db_valid && !staged_valid) {
+				valid_ = false;
+				return;
+			}
+
+			int cmp = !db_valid ? -1 : (!staged_valid ? 1 : SLICE(staged_iter_->first).compare(iter_->key()));
+			if (cmp > 0) {
+				key_ = iter_->key().ToString();
+				value_ = iter_->value().ToString();
+				iter_->Next();
+				valid_ = true;
+				return;
+			}
+
+			if (cmp == 0) {
+				iter_->Next();
+			}
+
+			StagedMap::const_iterator staged = staged_iter_++;
+			if (!staged->second.deleted_) {
+				key_ = staged->first;
+				value_ = staged->second.value_;
+				valid_ = true;
+				return;
+			}
+		}
+	}
+
+	bool KeyValueDbIterator::Valid() const {
+		return valid_;
+	}
+
+	void KeyValueDbIterator::Next() {
+		Settle();
+	}
+
+	const std::string &KeyValueDbIterator::key() const {
+		return key_;
+	}
+
+	const std::string &KeyValueDbIterator::value() const {
+		return value_;
+	}
+
+	size_t KeyValueDb::StagedCount() {
+		utils::MutexGuard guard(staged_mutex_);
+		return staged_.size();
+	}
+
+	int32_t KeyValueDb::GetStaged(const std::string &key, std::string &value) {
+		utils::MutexGuard guard(staged_mutex_);
+		if (overlay_.empty()) {
+			return -1;
+		}
+
+		auto iter = overlay_.find(key);
+		if (iter == overlay_.end()) {
+			return -1;
+		}
+
+		if (iter->second.deleted_) {
+			return 0;
+		}
+		value = iter->second.value_;
+		return 1;
+	}
+
 #ifdef WIN32
 	LevelDbDriver::LevelDbDriver() {
 		db_ = NULL;
@@ -42,6 +246,11 @@ namespace bubi {
 
 	int32_t LevelDbDriver::Get(const std::string &key, std::string &value) {
 		assert(db_ != NULL);
+		int32_t staged = GetStaged(key, value);
+		if (staged >= 0) {
+			return staged;
+		}
+
 		leveldb::Status status = db_->Get(leveldb::ReadOptions(), key, &value);
 		if (status.ok()) {
 			return 1;
@@ -56,6 +265,17 @@ namespace bubi {
 		}
 	}
 
+	bool LevelDbDriver::MultiGet(const std::vector<std::string> &keys, std::vector<std::string> &values, std::vector<int32_t> &results) {
+		values.resize(keys.size());
+		results.resize(keys.size());
+		bool ret = true;
+		for (size_t i = 0; i < keys.size(); i++) {
+			results[i] = Get(keys[i], values[i]);
+			ret = ret && results[i] >= 0;
+		}
+		return ret;
+	}
+
 	bool LevelDbDriver::Put(const std::string &key, const std::string &value) {
 		assert(db_ != NULL);
 		leveldb::WriteOptions opt;
@@ -89,8 +309,10 @@ namespace bubi {
 		return status.ok();
 	}
 
-	void* LevelDbDriver::NewIterator() {
-		return db_->NewIterator(leveldb::ReadOptions());
+	KVDB::Iterator *LevelDbDriver::NewDbIterator(bool fill_cache) {
+		leveldb::ReadOptions options;
+		options.fill_cache = fill_cache;
+		return db_->NewIterator(options);
 	}
 
 	bool LevelDbDriver::GetOptions(Json::Value &options) {
@@ -99,37 +321,137 @@ namespace bubi {
 
 #else
 
+	class ColumnFamilyAppender : public WRITE_BATCH::Handler {
+		WRITE_BATCH *batch_;
+		rocksdb::ColumnFamilyHandle *column_family_;
+	public:
+		ColumnFamilyAppender(WRITE_BATCH *batch, rocksdb::ColumnFamilyHandle *column_family)
+			:batch_(batch), column_family_(column_family) {}
+
+		virtual void Put(const SLICE& key, const SLICE& value) override {
+			batch_->Put(column_family_, key, value);
+		}
+
+		virtual void Delete(const SLICE& key) override {
+			batch_->Delete(column_family_, key);
+		}
+	};
+
 	RocksDbDriver::RocksDbDriver() {
 		db_ = NULL;
+		column_family_ = NULL;
+		own_db_ = true;
+	}
+
+	RocksDbDriver::RocksDbDriver(const KeyValueDbConfigure &config, std::shared_ptr<rocksdb::Cache> block_cache) {
+		db_ = NULL;
+		column_family_ = NULL;
+		own_db_ = true;
+		config_ = config;
+		block_cache_ = block_cache;
+	}
+
+	RocksDbDriver::RocksDbDriver(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* column_family, const KeyValueDbConfigure &config, std::shared_ptr<rocksdb::Cache> block_cache) {
+		db_ = db;
+		column_family_ = column_family;
+		own_db_ = false;
+		config_ = config;
+		block_cache_ = block_cache;
+	}
+
+	static rocksdb::CompressionType CompressionFromName(const std::string &name) {
+		if (name == "snappy") return rocksdb::kSnappyCompression;
+		if (name == "zlib") return rocksdb::kZlibCompression;
+		if (name == "bzip2") return rocksdb::kBZip2Compression;
+		if (name == "lz4") return rocksdb::kLZ4Compression;
+		if (name == "lz4hc") return rocksdb::kLZ4HCCompression;
+		return rocksdb::kNoCompression;
+	}
+
+	//average bytes of a trie node entry in the memtable, sizes the memtable prefix bloom to the keys a full buffer holds
+	static const int64_t MEMTABLE_ENTRY_SIZE = 100;
+
+	void RocksDbDriver::TuneColumnFamily(rocksdb::ColumnFamilyOptions &options, const KeyValueDbConfigure &config, std::shared_ptr<rocksdb::Cache> block_cache) {
+		//the trie reads random hash like keys, a whole key bloom filter saves most of the sst reads
+		rocksdb::BlockBasedTableOptions table_options;
+		if (block_cache) {
+			table_options.block_cache = block_cache;
+		}
+		table_options.block_size = config.block_size_ * utils::BYTES_PER_KILO;
+		if (config.bloom_bits_ > 0) {
+			table_options.filter_policy.reset(rocksdb::NewBloomFilterPolicy(config.bloom_bits_, false));
+		}
+		options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(table_options));
+
+		//prefixes like ACCOUNT_PREFIX, ASSET_PREFIX + address or METADATA_PREFIX + address
+		if (config.prefix_length_ > 0) {
+			options.prefix_extractor.reset(rocksdb::NewCappedPrefixTransform(config.prefix_length_));
+			if (config.bloom_bits_ > 0) {
+				int64_t expected_keys = (int64_t)config.write_buffer_size_ * utils::BYTES_PER_MEGA / MEMTABLE_ENTRY_SIZE;
+				options.memtable_prefix_bloom_bits = (uint32_t)std::min<int64_t>(expected_keys * config.bloom_bits_, UINT32_MAX);
+			}
+		}
+
+		options.write_buffer_size = config.write_buffer_size_ * utils::BYTES_PER_MEGA;
+		options.max_write_buffer_number = config.max_write_buffer_number_;
+		if (!config.compression_.empty()) {
+			options.compression_per_level.clear();
+			for (utils::StringList::const_iterator iter = config.compression_.begin(); iter != config.compression_.end(); iter++) {
+				options.compression_per_level.push_back(CompressionFromName(*iter));
+			}
+		}
+	}
+
+	void RocksDbDriver::TuneDb(rocksdb::DBOptions &options, const KeyValueDbConfigure &config) {
+		options.max_background_compactions = config.max_background_compactions_;
+		options.max_background_flushes = config.max_background_flushes_;
+		options.max_open_files = config.max_open_files_;
 	}
 
 	RocksDbDriver::~RocksDbDriver() {
-		if (db_ != NULL) {
+		if (db_ != NULL && own_db_) {
 			delete db_;
-			db_ = NULL;
 		}
+		db_ = NULL;
 	}
 
 	bool RocksDbDriver::Open(const std::string &db_path) {
+		if (!own_db_) {
+			return db_ != NULL;
+		}
+
 		rocksdb::Options options;
 		options.create_if_missing = true;
+		TuneColumnFamily(options, config_, block_cache_);
+		TuneDb(options, config_);
 		rocksdb::Status status = rocksdb::DB::Open(options, db_path, &db_);
 		if (!status.ok()) {
 			utils::MutexGuard guard(mutex_);
 			error_desc_ = status.ToString();
 		}
+		else {
+			column_family_ = db_->DefaultColumnFamily();
+		}
 		return status.ok();
 	}
 
 	bool RocksDbDriver::Close() {
-		delete db_;
+		if (own_db_) {
+			delete db_;
+		}
 		db_ = NULL;
+		column_family_ = NULL;
 		return true;
 	}
 
 	int32_t RocksDbDriver::Get(const std::string &key, std::string &value) {
 		assert(db_ != NULL);
-		rocksdb::Status status = db_->Get(rocksdb::ReadOptions(), key, &value);
+		int32_t staged = GetStaged(key, value);
+		if (staged >= 0) {
+			return staged;
+		}
+
+		rocksdb::Status status = db_->Get(rocksdb::ReadOptions(), column_family_, key, &value);
 		if (status.ok()) {
 			return 1;
 		}
@@ -143,11 +465,53 @@ namespace bubi {
 		}
 	}
 
+	bool RocksDbDriver::MultiGet(const std::vector<std::string> &keys, std::vector<std::string> &values, std::vector<int32_t> &results) {
+		assert(db_ != NULL);
+		values.resize(keys.size());
+		results.resize(keys.size());
+
+		//only the keys not served by the staged batches go to the db
+		std::vector<size_t> indexes;
+		std::vector<rocksdb::Slice> slices;
+		for (size_t i = 0; i < keys.size(); i++) {
+			results[i] = GetStaged(keys[i], values[i]);
+			if (results[i] < 0) {
+				indexes.push_back(i);
+				slices.push_back(keys[i]);
+			}
+		}
+		if (slices.empty()) {
+			return true;
+		}
+
+		std::vector<std::string> db_values;
+		std::vector<rocksdb::ColumnFamilyHandle*> column_families(slices.size(), column_family_);
+		std::vector<rocksdb::Status> status = db_->MultiGet(rocksdb::ReadOptions(), column_families, slices, &db_values);
+		bool ret = true;
+		for (size_t i = 0; i < status.size(); i++) {
+			size_t index = indexes[i];
+			if (status[i].ok()) {
+				values[index].swap(db_values[i]);
+				results[index] = 1;
+			}
+			else if (status[i].IsNotFound()) {
+				results[index] = 0;
+			}
+			else {
+				utils::MutexGuard guard(mutex_);
+				error_desc_ = status[i].ToString();
+				results[index] = -1;
+				ret = false;
+			}
+		}
+		return ret;
+	}
+
 	bool RocksDbDriver::Put(const std::string &key, const std::string &value) {
 		assert(db_ != NULL);
 		rocksdb::WriteOptions opt;
 		opt.sync = true;
-		rocksdb::Status status = db_->Put(opt, key, value);
+		rocksdb::Status status = db_->Put(opt, column_family_, key, value);
 		if (!status.ok()) {
 			utils::MutexGuard guard(mutex_);
 			error_desc_ = status.ToString();
@@ -159,7 +523,7 @@ namespace bubi {
 		assert(db_ != NULL);
 		rocksdb::WriteOptions opt;
 		opt.sync = true;
-		rocksdb::Status status = db_->Delete(opt, key);
+		rocksdb::Status status = db_->Delete(opt, column_family_, key);
 		if (!status.ok()) {
 			utils::MutexGuard guard(mutex_);
 			error_desc_ = status.ToString();
@@ -167,11 +531,25 @@ namespace bubi {
 		return status.ok();
 	}
 
+	void RocksDbDriver::AppendToBatch(WRITE_BATCH &dest, WRITE_BATCH &src) {
+		ColumnFamilyAppender appender(&dest, column_family_);
+		src.Iterate(&appender);
+	}
+
 	bool RocksDbDriver::WriteBatch(WRITE_BATCH &write_batch) {
 
 		rocksdb::WriteOptions opt;
 		opt.sync = true;
-		rocksdb::Status status = db_->Write(opt, &write_batch);
+		rocksdb::Status status;
+		if (own_db_) {
+			status = db_->Write(opt, &write_batch);
+		}
+		else {
+			//the callers fill the default family, move the operations to this one
+			WRITE_BATCH family_batch;
+			AppendToBatch(family_batch, write_batch);
+			status = db_->Write(opt, &family_batch);
+		}
 		if (!status.ok()) {
 			utils::MutexGuard guard(mutex_);
 			error_desc_ = status.ToString();
@@ -179,28 +557,191 @@ namespace bubi {
 		return status.ok();
 	}
 
-	void* RocksDbDriver::NewIterator() {
-		return db_->NewIterator(rocksdb::ReadOptions());
+	KVDB::Iterator *RocksDbDriver::NewDbIterator(bool fill_cache) {
+		//keep full order iteration when a prefix extractor is configured
+		rocksdb::ReadOptions options;
+		options.total_order_seek = true;
+		options.fill_cache = fill_cache;
+		return db_->NewIterator(options, column_family_);
 	}
 
 	bool RocksDbDriver::GetOptions(Json::Value &options) {
 		std::string out;
-		db_->GetProperty("rocksdb.estimate-table-readers-mem", &out);
+		db_->GetProperty(column_family_, "rocksdb.estimate-table-readers-mem", &out);
 		options["rocksdb.estimate-table-readers-mem"] = out;
 
-		db_->GetProperty("rocksdb.cur-size-all-mem-tables", &out);
+		db_->GetProperty(column_family_, "rocksdb.cur-size-all-mem-tables", &out);
 		options["rocksdb.cur-size-all-mem-tables"] = out;
 
-		db_->GetProperty("rocksdb.stats", &out);
+		db_->GetProperty(column_family_, "rocksdb.estimate-num-keys", &out);
+		options["rocksdb.estimate-num-keys"] = out;
+
+		db_->GetProperty(column_family_, "rocksdb.num-immutable-mem-table", &out);
+		options["rocksdb.num-immutable-mem-table"] = out;
+
+		db_->GetProperty(column_family_, "rocksdb.stats", &out);
 		options["rocksdb.stats"] = out;
+
+		if (block_cache_) {
+			options["block_cache_capacity"] = (Json::UInt64)block_cache_->GetCapacity();
+			options["block_cache_usage"] = (Json::UInt64)block_cache_->GetUsage();
+		}
+		config_.ToJson(options["tuning"]);
 		return true;
 	}
 #endif
 
+	MemoryDbDriver::MemoryDbDriver() {
+		data_ = std::make_shared<Map>();
+	}
+
+	MemoryDbDriver::~MemoryDbDriver() {}
+
+	//the caller holds mutex_
+	MemoryDbDriver::Map &MemoryDbDriver::MutableData() {
+		if (data_.use_count() > 1) {
+			data_ = std::make_shared<Map>(*data_);
+		}
+		return *data_;
+	}
+
+	bool MemoryDbDriver::Open(const std::string &db_path) {
+		return true;
+	}
+
+	bool MemoryDbDriver::Close() {
+		utils::MutexGuard guard(mutex_);
+		data_ = std::make_shared<Map>();
+		return true;
+	}
+
+	int32_t MemoryDbDriver::Get(const std::string &key, std::string &value) {
+		int32_t staged = GetStaged(key, value);
+		if (staged >= 0) {
+			return staged;
+		}
+
+		utils::MutexGuard guard(mutex_);
+		Map::const_iterator iter = data_->find(key);
+		if (iter == data_->end()) {
+			return 0;
+		}
+		value = iter->second;
+		return 1;
+	}
+
+	bool MemoryDbDriver::MultiGet(const std::vector<std::string> &keys, std::vector<std::string> &values, std::vector<int32_t> &results) {
+		values.resize(keys.size());
+		results.resize(keys.size());
+		for (size_t i = 0; i < keys.size(); i++) {
+			results[i] = Get(keys[i], values[i]);
+		}
+		return true;
+	}
+
+	bool MemoryDbDriver::Put(const std::string &key, const std::string &value) {
+		utils::MutexGuard guard(mutex_);
+		MutableData()[key] = value;
+		return true;
+	}
+
+	bool MemoryDbDriver::Delete(const std::string &key) {
+		utils::MutexGuard guard(mutex_);
+		MutableData().erase(key);
+		return true;
+	}
+
+	class MemoryBatchReplayer : public WRITE_BATCH::Handler {
+		MemoryDbDriver::Map &data_;
+	public:
+		MemoryBatchReplayer(MemoryDbDriver::Map &data) :data_(data) {}
+
+		virtual void Put(const SLICE& key, const SLICE& value) override {
+			data_[key.ToString()] = value.ToString();
+		}
+
+		virtual void Delete(const SLICE& key) override {
+			data_.erase(key.ToString());
+		}
+	};
+
+	bool MemoryDbDriver::WriteBatch(WRITE_BATCH &write_batch) {
+		utils::MutexGuard guard(mutex_);
+		MemoryBatchReplayer replayer(MutableData());
+		write_batch.Iterate(&replayer);
+		return true;
+	}
+
+	//iterates the map version current when it was created
+	class MemoryDbIterator : public KVDB::Iterator {
+		MemoryDbDriver::MapPointer data_;
+		MemoryDbDriver::Map::const_iterator iter_;
+	public:
+		MemoryDbIterator(MemoryDbDriver::MapPointer data) :data_(data) {
+			iter_ = data_->end();
+		}
+
+		virtual bool Valid() const override {
+			return iter_ != data_->end();
+		}
+
+		virtual void SeekToFirst() override {
+			iter_ = data_->begin();
+		}
+
+		virtual void SeekToLast() override {
+			iter_ = data_->empty() ? data_->end() : --data_->end();
+		}
+
+		virtual void Seek(const SLICE& target) override {
+			iter_ = data_->lower_bound(target.ToString());
+		}
+
+		virtual void Next() override {
+			++iter_;
+		}
+
+		virtual void Prev() override {
+			iter_ = (iter_ == data_->begin()) ? data_->end() : --iter_;
+		}
+
+		virtual SLICE key() const override {
+			return SLICE(iter_->first);
+		}
+
+		virtual SLICE value() const override {
+			return SLICE(iter_->second);
+		}
+
+		virtual KVDB::Status status() const override {
+			return KVDB::Status::OK();
+		}
+	};
+
+	KVDB::Iterator *MemoryDbDriver::NewDbIterator(bool fill_cache) {
+		utils::MutexGuard guard(mutex_);
+		return new MemoryDbIterator(data_);
+	}
+
+	bool MemoryDbDriver::GetOptions(Json::Value &options) {
+		utils::MutexGuard guard(mutex_);
+		size_t bytes = 0;
+		for (Map::const_iterator iter = data_->begin(); iter != data_->end(); iter++) {
+			bytes += iter->first.size() + iter->second.size();
+		}
+		options["engine"] = "memory";
+		options["key_count"] = (Json::UInt64)data_->size();
+		options["bytes"] = (Json::UInt64)bytes;
+		return true;
+	}
+
 	Storage::Storage() {
 		keyvalue_db_ = NULL;
 		ledger_db_ = NULL;
 		account_db_ = NULL;
+#ifndef WIN32
+		shared_db_ = NULL;
+#endif
 		check_interval_ = utils::MICRO_UNITS_PER_SEC;
 	}
 
@@ -227,10 +768,35 @@ namespace bubi {
 			}
 
 			if (bdropdb) {
+				if (db_config.key_value_db_type_ == "memory") {
+					LOG_INFO("Drop db successful");
+					return true;
+				}
+
 				bool do_success = false;
 				do {
+#ifndef WIN32
+					if (!db_config.column_family_db_path_.empty()) {
+						//check the db if opened
+						bool opened = OpenColumnFamilies(db_config.column_family_db_path_, db_config);
+						CloseDb();
+						if (!opened) {
+							LOG_ERROR("Database in used, drop failed");
+							break;
+						}
+
+						if (utils::File::IsExist(db_config.column_family_db_path_) && !utils::File::DeleteFolder(db_config.column_family_db_path_)) {
+							LOG_ERROR_ERRNO("Delete column family db failed", STD_ERR_CODE, STD_ERR_DESC);
+							break;
+						}
+
+						LOG_INFO("Drop db successful");
+						do_success = true;
+						break;
+					}
+#endif
 					//check the db if opened
-					KeyValueDb *account_db = NewKeyValueDb(db_config);
+					KeyValueDb *account_db = NewKeyValueDb(db_config.account_options_);
 					if (!account_db->Open(db_config.account_db_path_)) {
 						delete account_db;
 						LOG_ERROR("Database in used, drop failed");
@@ -260,21 +826,46 @@ namespace bubi {
 				return do_success;
 			}
 
-			keyvalue_db_ = NewKeyValueDb(db_config);
+			if (db_config.key_value_db_type_ == "memory") {
+				keyvalue_db_ = new MemoryDbDriver();
+				ledger_db_ = new MemoryDbDriver();
+				account_db_ = new MemoryDbDriver();
+				LOG_INFO("Key value dbs are kept in memory");
+
+				TimerNotify::RegisterModule(this);
+				return true;
+			}
+
+#ifndef WIN32
+			if (db_config.block_cache_size_ > 0) {
+				block_cache_ = rocksdb::NewLRUCache((size_t)db_config.block_cache_size_ * utils::BYTES_PER_MEGA);
+			}
+
+			if (!db_config.column_family_db_path_.empty()) {
+				if (!OpenColumnFamilies(db_config.column_family_db_path_, db_config)) {
+					break;
+				}
+
+				TimerNotify::RegisterModule(this);
+				return true;
+			}
+#endif
+
+			keyvalue_db_ = NewKeyValueDb(db_config.keyvalue_options_);
 			if (!keyvalue_db_->Open(db_config.keyvalue_db_path_)) {
 				LOG_ERROR("Keyvalue_db path(%s) open fail(%s)\n",
 					db_config.keyvalue_db_path_.c_str(), keyvalue_db_->error_desc().c_str());
 				break;
 			}
 
-			ledger_db_ = NewKeyValueDb(db_config);
+			ledger_db_ = NewKeyValueDb(db_config.ledger_options_);
 			if (!ledger_db_->Open(db_config.ledger_db_path_)) {
 				LOG_ERROR("Ledger db path(%s) open fail(%s)\n",
 					db_config.ledger_db_path_.c_str(), ledger_db_->error_desc().c_str());
 				break;
 			}
 
-			account_db_ = NewKeyValueDb(db_config);
+			account_db_ = NewKeyValueDb(db_config.account_options_);
 			if (!account_db_->Open(db_config.account_db_path_)) {
 				LOG_ERROR("Ledger db path(%s) open fail(%s)\n",
 					db_config.account_db_path_.c_str(), account_db_->error_desc().c_str());
@@ -311,9 +902,100 @@ namespace bubi {
 			account_db_ = NULL;
 		}
 
+#ifndef WIN32
+		if (shared_db_ != NULL) {
+			for (size_t i = 0; i < column_families_.size(); i++) {
+				delete column_families_[i];
+			}
+			column_families_.clear();
+			delete shared_db_;
+			shared_db_ = NULL;
+		}
+		block_cache_.reset();
+#endif
+
 		return ret1 && ret2 && ret3;
 	}
 
+#ifndef WIN32
+	bool Storage::OpenColumnFamilies(const std::string &db_path, const DbConfigure &db_config) {
+		rocksdb::ColumnFamilyOptions keyvalue_options, ledger_options, account_options;
+		RocksDbDriver::TuneColumnFamily(keyvalue_options, db_config.keyvalue_options_, block_cache_);
+		RocksDbDriver::TuneColumnFamily(ledger_options, db_config.ledger_options_, block_cache_);
+		RocksDbDriver::TuneColumnFamily(account_options, db_config.account_options_, block_cache_);
+
+		std::vector<rocksdb::ColumnFamilyDescriptor> descriptors;
+		descriptors.push_back(rocksdb::ColumnFamilyDescriptor(rocksdb::kDefaultColumnFamilyName, rocksdb::ColumnFamilyOptions()));
+		descriptors.push_back(rocksdb::ColumnFamilyDescriptor("keyvalue", keyvalue_options));
+		descriptors.push_back(rocksdb::ColumnFamilyDescriptor("ledger", ledger_options));
+		descriptors.push_back(rocksdb::ColumnFamilyDescriptor("account", account_options));
+
+		//the background jobs are shared by the families, the account db is the busiest one
+		rocksdb::DBOptions options;
+		RocksDbDriver::TuneDb(options, db_config.account_options_);
+		options.create_if_missing = true;
+		options.create_missing_column_families = true;
+		rocksdb::Status status = rocksdb::DB::Open(options, db_path, descriptors, &column_families_, &shared_db_);
+		if (!status.ok()) {
+			LOG_ERROR("Column family db path(%s) open fail(%s)\n", db_path.c_str(), status.ToString().c_str());
+			shared_db_ = NULL;
+			column_families_.clear();
+			return false;
+		}
+
+		keyvalue_db_ = new RocksDbDriver(shared_db_, column_families_[1], db_config.keyvalue_options_, block_cache_);
+		ledger_db_ = new RocksDbDriver(shared_db_, column_families_[2], db_config.ledger_options_, block_cache_);
+		account_db_ = new RocksDbDriver(shared_db_, column_families_[3], db_config.account_options_, block_cache_);
+		return true;
+	}
+#endif
+
+	bool Storage::IsAtomicCommit() {
+#ifdef WIN32
+		return false;
+#else
+		return shared_db_ != NULL;
+#endif
+	}
+
+	bool Storage::WriteStagedLedger() {
+#ifndef WIN32
+		if (shared_db_ != NULL) {
+			std::shared_ptr<WRITE_BATCH> ledger_batch = ledger_db_->FrontStaged();
+			std::shared_ptr<WRITE_BATCH> account_batch = account_db_->FrontStaged();
+
+			//one write for both families, a crash never leaves them at different ledgers
+			WRITE_BATCH batch;
+			//with shared_db_ both are the family drivers Storage::Initialize built
+			if (ledger_batch) static_cast<RocksDbDriver *>(ledger_db_)->AppendToBatch(batch, *ledger_batch);
+			if (account_batch) static_cast<RocksDbDriver *>(account_db_)->AppendToBatch(batch, *account_batch);
+
+			rocksdb::WriteOptions opt;
+			opt.sync = true;
+			rocksdb::Status status = shared_db_->Write(opt, &batch);
+			if (!status.ok()) {
+				LOG_ERROR("Write ledger failed(%s)", status.ToString().c_str());
+				return false;
+			}
+
+			if (ledger_batch) ledger_db_->PopStaged();
+			if (account_batch) account_db_->PopStaged();
+			return true;
+		}
+#endif
+
+		if (!ledger_db_->WriteStaged()) {
+			LOG_ERROR("Write ledger and transaction failed(%s)", ledger_db_->error_desc().c_str());
+			return false;
+		}
+
+		if (!account_db_->WriteStaged()) {
+			LOG_ERROR("Write account failed(%s)", account_db_->error_desc().c_str());
+			return false;
+		}
+		return true;
+	}
+
 	bool Storage::Exit() {
 		return CloseDb();
 	}
@@ -333,12 +1015,12 @@ namespace bubi {
 		return account_db_;
 	}
 
-	KeyValueDb *Storage::NewKeyValueDb(const DbConfigure &db_config) {
+	KeyValueDb *Storage::NewKeyValueDb(const KeyValueDbConfigure &options) {
 		KeyValueDb *db = NULL;
 #ifdef WIN32
 		db = new LevelDbDriver();
 #else
-		db = new RocksDbDriver();
+		db = new RocksDbDriver(options, block_cache_);
 #endif
 
 		return db;
@@ -12,6 +12,7 @@
 #include <leveldb/leveldb.h>
 #else
 #include <rocksdb/db.h>
+#include <rocksdb/cache.h>
 #endif
 
 namespace bubi {
@@ -29,16 +30,82 @@ namespace bubi {
 #define SLICE       rocksdb::Slice
 #endif
 
+	//forward iterator over a key range of a KeyValueDb, the staged batches of the db included
+	class KeyValueDbIterator {
+	public:
+		struct Options {
+			std::string prefix_; //only the keys starting with prefix_
+			std::string upper_bound_; //exclusive, empty: the end of the prefix
+			bool fill_cache_; //false for bulk scans that should not evict the hot blocks
+			Options() : fill_cache_(true) {}
+		};
+
+		//staged value of a key in the range, deleted_ shadows the db value
+		struct StagedEntry {
+			bool deleted_;
+			std::string value_;
+		};
+		typedef std::map<std::string, StagedEntry> StagedMap;
+
+		KeyValueDbIterator(KVDB::Iterator *iter, const std::string &lower_bound, const std::string &upper_bound, StagedMap &staged);
+		~KeyValueDbIterator();
+
+		bool Valid() const;
+		void Next();
+		const std::string &key() const;
+		const std::string &value() const;
+
+		//the first key after all the keys starting with prefix, empty if there is none
+		static std::string PrefixEnd(const std::string &prefix);
+
+	private:
+		KVDB::Iterator *iter_;
+		std::string upper_bound_;
+		StagedMap staged_;
+		StagedMap::const_iterator staged_iter_;
+		bool valid_;
+		std::string key_;
+		std::string value_;
+
+		bool DbValid() const;
+		void Settle();
+		UTILS_DISALLOW_EVIL_CONSTRUCTORS(KeyValueDbIterator);
+	};
+	typedef std::unique_ptr<KeyValueDbIterator> KeyValueDbIteratorPtr;
+
 	class KeyValueDb {
+		friend class StagedKeyCollector;
 	protected:
 		utils::Mutex mutex_;
 		std::string error_desc_;
+
+		//batches staged but not yet written, readers see them through the overlay
+		struct StagedBatch {
+			std::shared_ptr<WRITE_BATCH> batch_;
+			std::vector<std::string> keys_;
+		};
+		struct StagedValue {
+			const WRITE_BATCH *owner_; //the latest staged batch writing the key
+			bool deleted_;
+			std::string value_;
+		};
+		utils::Mutex staged_mutex_;
+		std::list<StagedBatch> staged_;
+		std::unordered_map<std::string, StagedValue> overlay_;
+
+		//return 1 or 0 like Get if the key is staged, -1 if the key must be read from the db
+		int32_t GetStaged(const std::string &key, std::string &value);
+
+		//a raw engine iterator, the caller owns it
+		virtual KVDB::Iterator *NewDbIterator(bool fill_cache) = 0;
 	public:
 		KeyValueDb();
-		~KeyValueDb();
+		virtual ~KeyValueDb();
 		virtual bool Open(const std::string &db_path) = 0;
 		virtual bool Close() = 0;
 		virtual int32_t Get(const std::string &key, std::string &value) = 0;
+		//results[i] is the Get result of keys[i], return false if any read failed
+		virtual bool MultiGet(const std::vector<std::string> &keys, std::vector<std::string> &values, std::vector<int32_t> &results) = 0;
 		virtual bool Put(const std::string &key, const std::string &value) = 0;
 		virtual bool Delete(const std::string &key) = 0;
 		virtual bool GetOptions(Json::Value &options) = 0;
@@ -47,7 +114,17 @@ namespace bubi {
 		}
 		virtual bool WriteBatch(WRITE_BATCH &values) = 0;
 
-		virtual void* NewIterator() = 0;
+		//make the batch visible to Get and MultiGet now, WriteStaged writes it later in staging order
+		void Stage(std::shared_ptr<WRITE_BATCH> batch);
+		//write the oldest staged batch, return true if there is none
+		bool WriteStaged();
+		size_t StagedCount();
+		//the oldest staged batch or NULL, PopStaged drops it once it is written by other means
+		std::shared_ptr<WRITE_BATCH> FrontStaged();
+		void PopStaged();
+
+		//iterate the range selected by options, positioned on its first key
+		KeyValueDbIteratorPtr NewIterator(const KeyValueDbIterator::Options &options = KeyValueDbIterator::Options());
 	};
 
 #ifdef WIN32
@@ -62,34 +139,80 @@ namespace bubi {
 		bool Open(const std::string &db_path);
 		bool Close();
 		int32_t Get(const std::string &key, std::string &value);
+		bool MultiGet(const std::vector<std::string> &keys, std::vector<std::string> &values, std::vector<int32_t> &results);
 		bool Put(const std::string &key, const std::string &value);
 		bool Delete(const std::string &key);
 		bool GetOptions(Json::Value &options);
 		bool WriteBatch(WRITE_BATCH &values);
 
-		void* NewIterator();
+	protected:
+		KVDB::Iterator *NewDbIterator(bool fill_cache);
 	};
 #else
 	class RocksDbDriver : public KeyValueDb {
 	private:
 		rocksdb::DB* db_;
+		rocksdb::ColumnFamilyHandle* column_family_;
+		bool own_db_;
+		KeyValueDbConfigure config_;
+		std::shared_ptr<rocksdb::Cache> block_cache_;
 
 	public:
 		RocksDbDriver();
+		RocksDbDriver(const KeyValueDbConfigure &config, std::shared_ptr<rocksdb::Cache> block_cache);
+		//a column family of a db opened and closed by the caller
+		RocksDbDriver(rocksdb::DB* db, rocksdb::ColumnFamilyHandle* column_family, const KeyValueDbConfigure &config, std::shared_ptr<rocksdb::Cache> block_cache);
 		~RocksDbDriver();
 
+		//the rocksdb options of a db tuned by config, block_cache may be shared by several dbs
+		static void TuneColumnFamily(rocksdb::ColumnFamilyOptions &options, const KeyValueDbConfigure &config, std::shared_ptr<rocksdb::Cache> block_cache);
+		static void TuneDb(rocksdb::DBOptions &options, const KeyValueDbConfigure &config);
+
+		//copy the default family operations of src into dest, on this column family
+		void AppendToBatch(WRITE_BATCH &dest, WRITE_BATCH &src);
+
 		bool Open(const std::string &db_path);
 		bool Close();
 		int32_t Get(const std::string &key, std::string &value);
+		bool MultiGet(const std::vector<std::string> &keys, std::vector<std::string> &values, std::vector<int32_t> &results);
 		bool Put(const std::string &key, const std::string &value);
 		bool Delete(const std::string &key);
 		bool GetOptions(Json::Value &options);
 		bool WriteBatch(WRITE_BATCH &values);
 
-		void* NewIterator();
+	protected:
+		KVDB::Iterator *NewDbIterator(bool fill_cache);
 	};
 #endif
 
+	//a sorted map in process memory, for benchmarks and nodes that keep nothing on disk
+	class MemoryDbDriver : public KeyValueDb {
+	public:
+		typedef std::map<std::string, std::string> Map;
+		typedef std::shared_ptr<const Map> MapPointer;
+
+	private:
+		//iterators share data_, a write copies it while an iterator holds it
+		std::shared_ptr<Map> data_;
+		Map &MutableData();
+
+	public:
+		MemoryDbDriver();
+		~MemoryDbDriver();
+
+		bool Open(const std::string &db_path);
+		bool Close();
+		int32_t Get(const std::string &key, std::string &value);
+		bool MultiGet(const std::vector<std::string> &keys, std::vector<std::string> &values, std::vector<int32_t> &results);
+		bool Put(const std::string &key, const std::string &value);
+		bool Delete(const std::string &key);
+		bool GetOptions(Json::Value &options);
+		bool WriteBatch(WRITE_BATCH &values);
+
+	protected:
+		KVDB::Iterator *NewDbIterator(bool fill_cache);
+	};
+
 	class Storage : public utils::Singleton<bubi::Storage>, public TimerNotify {
 		friend class utils::Singleton<Storage>;
 	private:
@@ -99,12 +222,19 @@ namespace bubi {
 		KeyValueDb *keyvalue_db_;
 		KeyValueDb *ledger_db_;
 		KeyValueDb *account_db_;
+#ifndef WIN32
+		//all the dbs are column families of shared_db_ when column_family_db_path is set
+		rocksdb::DB *shared_db_;
+		std::vector<rocksdb::ColumnFamilyHandle*> column_families_;
+		std::shared_ptr<rocksdb::Cache> block_cache_;
+		bool OpenColumnFamilies(const std::string &db_path, const DbConfigure &db_config);
+#endif
 
 		bool CloseDb();
 		bool DescribeTable(const std::string &name, const std::string &sql_create_table);
 		bool ManualDescribeTables();
 
-		KeyValueDb *NewKeyValueDb(const DbConfigure &db_config);
+		KeyValueDb *NewKeyValueDb(const KeyValueDbConfigure &options);
 	public:
 		bool Initialize(const DbConfigure &db_config, bool bdropdb);
 		bool Exit();
@@ -113,6 +243,11 @@ namespace bubi {
 		KeyValueDb *account_db();   //storage account tree
 		KeyValueDb *ledger_db();    //storage transaction and ledger
 
+		//true if the ledger and account db are written in one atomic write
+		bool IsAtomicCommit();
+		//write the oldest staged batch of the ledger db and then the account db
+		bool WriteStagedLedger();
+
 		virtual void OnTimer(int64_t current_time) {};
 		virtual void OnSlowTimer(int64_t current_time);
 	};
@@ -80,33 +80,33 @@ namespace bubi {
 		protocol::LedgerHeader lcl = LedgerManager::Instance().GetLastClosedLedger();
 		//get cached tx, if error then delete it
 		TransactionSetFrm txset;
-		size_t del_size = 0;
-		std::vector<TransactionFrm::pointer> err_txs;
-		do {
-			utils::MutexGuard guard(lock_);
-			std::string skip_address;
-			for (TransactionMap::iterator iter = topic_caches_.begin();
-				iter != topic_caches_.end();) {
-				if (iter->first.GetTopic() == skip_address) {
-					iter++;
-					continue;
-				} else{
-					int32_t ret = txset.Add(iter->second);
-					if (ret < 0) {
-						err_txs.push_back(iter->second);
-						iter = topic_caches_.erase(iter);
-						del_size++;
-					}
-					else if (ret == 0) {
-						skip_address = iter->first.GetTopic();
-						iter++;
-					}
-					else {
-						iter++;
-					}
-				}
+		std::vector<TransactionFrm::pointer> ready_txs, err_txs;
+		tx_queue_.GetReady(lcl.seq(), Configure::Instance().ledger_configure_.max_trans_per_ledger_, General::TXSET_LIMIT_SIZE, ready_txs, err_txs);
+		size_t del_size = err_txs.size();
+
+		//the queue is not locked here, txset.Add reads the source accounts from the db
+		std::vector<TransactionFrm::pointer> old_txs;
+		std::string skip_address;
+		for (size_t i = 0; i < ready_txs.size(); i++) {
+			const std::string &address = ready_txs[i]->GetTransactionEnv().transaction().source_address();
+			if (address == skip_address) {
+				continue;
+			}
+
+			int32_t ret = txset.Add(ready_txs[i]);
+			if (ret < 0) {
+				old_txs.push_back(ready_txs[i]);
 			}
-		} while (false);
+			else if (ret == 0) {
+				skip_address = address;
+			}
+		}
+
+		if (old_txs.size() > 0) {
+			tx_queue_.Remove(old_txs);
+			del_size += old_txs.size();
+			err_txs.insert(err_txs.end(), old_txs.begin(), old_txs.end());
+		}
 
 		if (err_txs.size() > 0){
 			NotifyErrTx(err_txs);
@@ -159,17 +159,16 @@ namespace bubi {
 		std::string address = tx->GetSourceAddress();
 
 		do {
+			//a cheap early answer, Insert enforces the limit
 			int64_t max_trans = Configure::Instance().ledger_configure_.max_trans_in_memory_;
-			utils::MutexGuard guard(lock_);
-			if (topic_caches_.size() >= max_trans){
+			if (tx_queue_.Size() >= max_trans){
 				err.set_code(protocol::ERRCODE_OUT_OF_TXCACHE);
 				err.set_desc("too much transactions");
 				LOG_ERROR("Too much transactions,transaction hash(%s)", utils::String::Bin4ToHexString(hash_value).c_str());
 				break;
 			}
 
-			TransactionMap::iterator iter = topic_caches_.find(key);
-			if (iter != topic_caches_.end())  {
+			if (tx_queue_.Has(address, key.GetSeq()))  {
 				//dont't reply the tx, then break;
 				//err.set_code(protocol::ERRCODE_ALREADY_EXIST);
 				//err.set_desc(utils::String::Format("Receive duplicate transaction, source address(%s) hash(%s)", address.c_str(), utils::String::Bin4ToHexString(hash_value).c_str()));
@@ -189,9 +188,28 @@ namespace bubi {
 				break;
 			}
 
+			//checked without the lock, other submitters may have filled the queue or queued the same nonce meanwhile
+			TransactionQueue::InsertResult insert_ret = tx_queue_.Insert(tx, max_trans);
+			if (insert_ret == TransactionQueue::INSERT_FULL) {
+				err.set_code(protocol::ERRCODE_OUT_OF_TXCACHE);
+				err.set_desc("too much transactions");
+				LOG_ERROR("Too much transactions,transaction hash(%s)", utils::String::Bin4ToHexString(hash_value).c_str());
+				break;
+			}
+			else if (insert_ret == TransactionQueue::INSERT_DUPLICATE) {
+				LOG_INFO("Receive duplicate transaction, source address(%s) hash(%s)", address.c_str(), utils::String::Bin4ToHexString(hash_value).c_str());
+				break;
+			}
+			else if (insert_ret == TransactionQueue::INSERT_BAD_SEQ) {
+				//a ledger closed since the check moved the nonce over it
+				err.set_code(protocol::ERRCODE_BAD_SEQUENCE);
+				err.set_desc(utils::String::Format("Tx nonce(" FMT_I64 ") too small, the account(%s) nonce moved", key.GetSeq(), address.c_str()));
+				LOG_ERROR("%s", err.desc().c_str());
+				break;
+			}
 			LOG_INFO("Recv new tx(%s:" FMT_I64 ")", key.GetTopic().c_str(), key.GetSeq());
-			topic_caches_.insert(std::make_pair(key, tx));
 
+			utils::MutexGuard guard(lock_);
 			if (empty_transaction_times_ > 0) {
 				empty_transaction_times_ = 0;
 
@@ -215,20 +233,7 @@ namespace bubi {
 		//check the timeout transaction
 
 		std::vector<TransactionFrm::pointer> timeout_txs;
-		do {
-			utils::MutexGuard guard(lock_);
-			for (TransactionMap::iterator iter = topic_caches_.begin(); iter != topic_caches_.end();) {
-				if (iter->second->CheckTimeout(current_time - QUEUE_TRANSACTION_TIMEOUT)) {
-					//notify
-					timeout_txs.push_back(iter->second);
-
-					iter = topic_caches_.erase(iter);
-				}
-				else {
-					iter++;
-				}
-			}
-		} while (false);
+		tx_queue_.RemoveTimeout(current_time - QUEUE_TRANSACTION_TIMEOUT, timeout_txs);
 
 		if (timeout_txs.size() > 0 ){
 			NotifyErrTx(timeout_txs);
@@ -238,19 +243,7 @@ namespace bubi {
 	}
 
 	size_t GlueManager::RemoveTxset(const TransactionSetFrm &set) {
-		utils::MutexGuard guard(lock_);
-		size_t ret = 0;
-		for (int32_t i = 0; i < set.GetRaw().txs_size(); i++) {
-			TransactionFrm tx(set.GetRaw().txs(i));
-
-			TransactionMap::iterator iter = topic_caches_.find(TopicKey(tx.GetSourceAddress(), tx.GetNonce()));
-			if (iter != topic_caches_.end()) {
-				topic_caches_.erase(iter);
-				ret++;
-			}
-		}
-
-		return ret;
+		return tx_queue_.RemoveCommitted(set.GetRaw());
 	}
 
 	void GlueManager::NotifyErrTx(std::vector<TransactionFrm::pointer> &txs) {
@@ -511,7 +504,7 @@ namespace bubi {
 	void GlueManager::GetModuleStatus(Json::Value &data) {
 		data["name"] = "glue_manager";
 
-		data["transaction_size"] = topic_caches_.size();
+		data["transaction_size"] = tx_queue_.Size();
 		data["cache_topic_size"] = last_topic_seqs_.size();
 
 		Json::Value &system_json = data["system"];
@@ -544,12 +537,9 @@ namespace bubi {
 		//there is still transaction in memory
 		bool trans_empty_in_memory = true;
 
-		do {
-			utils::MutexGuard guard(lock_);
-			if (topic_caches_.size() > 0) {
-				trans_empty_in_memory = false;
-			}
-		} while (false);
+		if (tx_queue_.Size() > 0) {
+			trans_empty_in_memory = false;
+		}
 
 		if (trans_empty_in_memory && empty_block) {
 			empty_transaction_times_++;
@@ -582,8 +572,7 @@ namespace bubi {
 	}
 
 	size_t GlueManager::GetTransactionCacheSize() {
-		utils::MutexGuard guard(lock_);
-		return topic_caches_.size();
+		return (size_t)tx_queue_.Size();
 	}
 
 }
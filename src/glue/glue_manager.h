@@ -8,6 +8,7 @@
 #include <overlay/peer.h>
 #include <consensus/consensus_manager.h>
 #include "transaction_set.h"
+#include "transaction_queue.h"
 #include "ledger_upgrade.h"
 
 namespace bubi {
@@ -20,8 +21,8 @@ namespace bubi {
 		friend class TransactionSetFrm;
 
 		std::map<std::string, int64_t> last_topic_seqs_;
-		TransactionMap topic_caches_;
-		utils::Mutex lock_;
+		TransactionQueue tx_queue_;
+		utils::Mutex lock_; //for the consensus timer restarted by a submitter
 
 		int64_t time_start_consenus_;
 		std::shared_ptr<Consensus> consensus_;
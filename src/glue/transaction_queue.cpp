@@ -0,0 +1,259 @@
+#include <ledger/environment.h>
+#include "transaction_queue.h"
+
+namespace bubi {
+
+	TransactionQueue::TransactionQueue() :size_(0) {}
+
+	TransactionQueue::~TransactionQueue() {}
+
+	bool TransactionQueue::Priority::operator()(const TransactionFrm::pointer &a, const TransactionFrm::pointer &b) const {
+		const protocol::Transaction &tran_a = a->GetTransactionEnv().transaction();
+		const protocol::Transaction &tran_b = b->GetTransactionEnv().transaction();
+		if (tran_a.fee() != tran_b.fee()) {
+			return tran_a.fee() > tran_b.fee();
+		}
+		if (a->GetInComingTime() != b->GetInComingTime()) {
+			return a->GetInComingTime() < b->GetInComingTime();
+		}
+		int compare = tran_a.source_address().compare(tran_b.source_address());
+		return compare < 0 || (compare == 0 && tran_a.nonce() < tran_b.nonce());
+	}
+
+	TransactionQueue::Shard &TransactionQueue::GetShard(const std::string &address) {
+		return shards_[std::hash<std::string>()(address) % SHARD_COUNT];
+	}
+
+	void TransactionQueue::EraseTx(Shard &shard, AccountQueue &account, std::map<int64_t, QueuedTx>::iterator tx_iter) {
+		shard.expiry_.erase(tx_iter->second.expiry_);
+		account.txs_.erase(tx_iter);
+		utils::AtomicDec(&size_);
+	}
+
+	void TransactionQueue::UpdateAccount(Shard &shard, std::unordered_map<std::string, AccountQueue>::iterator iter, std::vector<TransactionFrm::pointer> *removed) {
+		AccountQueue &account = iter->second;
+		while (!account.txs_.empty() && account.txs_.begin()->first <= account.chain_nonce_) {
+			if (removed != NULL) {
+				removed->push_back(account.txs_.begin()->second.tx_);
+			}
+			EraseTx(shard, account, account.txs_.begin());
+		}
+
+		//the first transaction may have changed, it is the key in the ready index
+		if (account.ready_head_) {
+			shard.ready_.erase(account.ready_head_);
+			account.ready_head_.reset();
+		}
+
+		if (account.txs_.empty()) {
+			shard.waiting_.erase(iter->first);
+			shard.accounts_.erase(iter);
+		}
+		else if (account.IsReady()) {
+			shard.waiting_.erase(iter->first);
+			account.ready_head_ = account.txs_.begin()->second.tx_;
+			shard.ready_.insert(account.ready_head_);
+		}
+		else {
+			shard.waiting_.insert(iter->first);
+		}
+	}
+
+	bool TransactionQueue::Has(const std::string &address, int64_t nonce) {
+		Shard &shard = GetShard(address);
+		utils::MutexGuard guard(shard.mutex_);
+		std::unordered_map<std::string, AccountQueue>::iterator iter = shard.accounts_.find(address);
+		return iter != shard.accounts_.end() && iter->second.txs_.find(nonce) != iter->second.txs_.end();
+	}
+
+	TransactionQueue::InsertResult TransactionQueue::Insert(const TransactionFrm::pointer &tx, int64_t max_count) {
+		const protocol::Transaction &tran = tx->GetTransactionEnv().transaction();
+		Shard &shard = GetShard(tran.source_address());
+		utils::MutexGuard guard(shard.mutex_);
+
+		std::unordered_map<std::string, AccountQueue>::iterator iter = shard.accounts_.find(tran.source_address());
+		if (iter != shard.accounts_.end() && tran.nonce() <= iter->second.chain_nonce_) {
+			return INSERT_BAD_SEQ;
+		}
+
+		//the slot is taken before the check, so the inserts of the other shards count while this one decides
+		if (utils::AtomicInc(&size_) > max_count) {
+			utils::AtomicDec(&size_);
+			return INSERT_FULL;
+		}
+
+		if (iter == shard.accounts_.end()) {
+			iter = shard.accounts_.insert(std::make_pair(tran.source_address(), AccountQueue())).first;
+		}
+
+		std::pair<std::map<int64_t, QueuedTx>::iterator, bool> ret = iter->second.txs_.insert(std::make_pair(tran.nonce(), QueuedTx()));
+		if (!ret.second) {
+			utils::AtomicDec(&size_);
+			return INSERT_DUPLICATE;
+		}
+		ret.first->second.tx_ = tx;
+		ret.first->second.expiry_ = shard.expiry_.insert(std::make_pair(tx->GetInComingTime(), tx));
+		UpdateAccount(shard, iter, NULL);
+		return INSERT_OK;
+	}
+
+	int64_t TransactionQueue::Size() const {
+		return size_;
+	}
+
+	void TransactionQueue::GetReady(int64_t lcl_seq, int64_t max_count, int64_t max_bytes,
+		std::vector<TransactionFrm::pointer> &ready_txs, std::vector<TransactionFrm::pointer> &stale_txs) {
+		for (size_t i = 0; i < SHARD_COUNT; i++) {
+			Shard &shard = shards_[i];
+
+			std::vector<std::string> addresses;
+			do {
+				utils::MutexGuard guard(shard.mutex_);
+				for (std::unordered_map<std::string, AccountQueue>::iterator iter = shard.accounts_.begin(); iter != shard.accounts_.end(); iter++) {
+					if (iter->second.nonce_seq_ < lcl_seq) {
+						addresses.push_back(iter->first);
+					}
+				}
+			} while (false);
+
+			//a trie walk each, so without the lock the submitters wait for
+			std::vector<int64_t> nonces(addresses.size(), 0);
+			for (size_t j = 0; j < addresses.size(); j++) {
+				AccountFrm::pointer account;
+				if (Environment::AccountFromDB(addresses[j], account)) {
+					nonces[j] = account->GetAccountNonce();
+				}
+			}
+
+			utils::MutexGuard guard(shard.mutex_);
+			for (size_t j = 0; j < addresses.size(); j++) {
+				std::unordered_map<std::string, AccountQueue>::iterator iter = shard.accounts_.find(addresses[j]);
+				if (iter == shard.accounts_.end()) {
+					continue;
+				}
+				iter->second.chain_nonce_ = std::max<int64_t>(iter->second.chain_nonce_, nonces[j]);
+				iter->second.nonce_seq_ = std::max<int64_t>(iter->second.nonce_seq_, lcl_seq);
+				UpdateAccount(shard, iter, &stale_txs);
+			}
+		}
+
+		//the heap holds the best ready account of each shard not taken from yet, and the next nonce of each account taken from
+		struct Candidate {
+			TransactionFrm::pointer tx_;
+			size_t shard_;
+			bool head_; //from the ready index of the shard
+		};
+		std::vector<Candidate> heap;
+		std::vector<ReadyIndex::const_iterator> next_heads(SHARD_COUNT);
+		auto heap_less = [](const Candidate &a, const Candidate &b) {
+			return Priority()(b.tx_, a.tx_);
+		};
+
+		for (size_t i = 0; i < SHARD_COUNT; i++) {
+			shards_[i].mutex_.Lock();
+			next_heads[i] = shards_[i].ready_.begin();
+			if (next_heads[i] != shards_[i].ready_.end()) {
+				Candidate candidate = { *next_heads[i]++, i, true };
+				heap.push_back(candidate);
+			}
+		}
+		std::make_heap(heap.begin(), heap.end(), heap_less);
+
+		int64_t bytes = 0;
+		size_t first = ready_txs.size();
+		while (!heap.empty() && (int64_t)(ready_txs.size() - first) < max_count) {
+			std::pop_heap(heap.begin(), heap.end(), heap_less);
+			Candidate candidate = heap.back();
+			heap.pop_back();
+
+			Shard &shard = shards_[candidate.shard_];
+			if (candidate.head_ && next_heads[candidate.shard_] != shard.ready_.end()) {
+				Candidate next = { *next_heads[candidate.shard_]++, candidate.shard_, true };
+				heap.push_back(next);
+				std::push_heap(heap.begin(), heap.end(), heap_less);
+			}
+
+			//too large for what is left, the later nonces of the account wait for the next txset
+			int64_t size = candidate.tx_->GetTransactionEnv().ByteSize();
+			if (bytes + size >= max_bytes) {
+				continue;
+			}
+			bytes += size;
+			ready_txs.push_back(candidate.tx_);
+
+			const protocol::Transaction &tran = candidate.tx_->GetTransactionEnv().transaction();
+			const AccountQueue &account = shard.accounts_[tran.source_address()];
+			std::map<int64_t, QueuedTx>::const_iterator tx_iter = account.txs_.find(tran.nonce() + 1);
+			if (tx_iter != account.txs_.end()) {
+				Candidate next = { tx_iter->second.tx_, candidate.shard_, false };
+				heap.push_back(next);
+				std::push_heap(heap.begin(), heap.end(), heap_less);
+			}
+		}
+
+		for (size_t i = 0; i < SHARD_COUNT; i++) {
+			shards_[i].mutex_.Unlock();
+		}
+
+		//only what was taken is sorted
+		std::sort(ready_txs.begin() + first, ready_txs.end(), [](const TransactionFrm::pointer &a, const TransactionFrm::pointer &b) {
+			const protocol::Transaction &tran_a = a->GetTransactionEnv().transaction();
+			const protocol::Transaction &tran_b = b->GetTransactionEnv().transaction();
+			int compare = tran_a.source_address().compare(tran_b.source_address());
+			return compare < 0 || (compare == 0 && tran_a.nonce() < tran_b.nonce());
+		});
+	}
+
+	void TransactionQueue::Remove(const std::vector<TransactionFrm::pointer> &txs) {
+		for (size_t i = 0; i < txs.size(); i++) {
+			const protocol::Transaction &tran = txs[i]->GetTransactionEnv().transaction();
+			Shard &shard = GetShard(tran.source_address());
+			utils::MutexGuard guard(shard.mutex_);
+			std::unordered_map<std::string, AccountQueue>::iterator iter = shard.accounts_.find(tran.source_address());
+			if (iter == shard.accounts_.end()) {
+				continue;
+			}
+			iter->second.chain_nonce_ = std::max<int64_t>(iter->second.chain_nonce_, tran.nonce());
+			UpdateAccount(shard, iter, NULL);
+		}
+	}
+
+	size_t TransactionQueue::RemoveCommitted(const protocol::TransactionEnvSet &txset) {
+		size_t ret = 0;
+		for (int32_t i = 0; i < txset.txs_size(); i++) {
+			const protocol::Transaction &tran = txset.txs(i).transaction();
+			Shard &shard = GetShard(tran.source_address());
+			utils::MutexGuard guard(shard.mutex_);
+			std::unordered_map<std::string, AccountQueue>::iterator iter = shard.accounts_.find(tran.source_address());
+			if (iter == shard.accounts_.end()) {
+				continue;
+			}
+
+			AccountQueue &account = iter->second;
+			std::map<int64_t, QueuedTx>::iterator tx_iter = account.txs_.find(tran.nonce());
+			if (tx_iter != account.txs_.end()) {
+				EraseTx(shard, account, tx_iter);
+				ret++;
+			}
+			//a transaction dropped by the apply left the nonce where it was, only the db knows
+			account.nonce_seq_ = -1;
+			UpdateAccount(shard, iter, NULL);
+		}
+		return ret;
+	}
+
+	void TransactionQueue::RemoveTimeout(int64_t expire_time, std::vector<TransactionFrm::pointer> &timeout_txs) {
+		for (size_t i = 0; i < SHARD_COUNT; i++) {
+			Shard &shard = shards_[i];
+			utils::MutexGuard guard(shard.mutex_);
+			while (!shard.expiry_.empty() && shard.expiry_.begin()->second->CheckTimeout(expire_time)) {
+				TransactionFrm::pointer tx = shard.expiry_.begin()->second;
+				const protocol::Transaction &tran = tx->GetTransactionEnv().transaction();
+				std::unordered_map<std::string, AccountQueue>::iterator iter = shard.accounts_.find(tran.source_address());
+				EraseTx(shard, iter->second, iter->second.txs_.find(tran.nonce()));
+				timeout_txs.push_back(tx);
+				UpdateAccount(shard, iter, NULL);
+			}
+		}
+	}
+}
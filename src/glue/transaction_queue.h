@@ -0,0 +1,90 @@
+#ifndef TRANSACTION_QUEUE_
+#define TRANSACTION_QUEUE_
+
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <utils/thread.h>
+#include <ledger/transaction_frm.h>
+
+namespace bubi {
+
+	//the pending transactions, one nonce ordered queue per source account, the accounts spread over shards with a lock each.
+	//An account is ready when its lowest queued nonce follows its nonce on chain, a proposal only visits the ready ones
+	class TransactionQueue {
+	public:
+		TransactionQueue();
+		~TransactionQueue();
+
+		enum InsertResult {
+			INSERT_OK,
+			INSERT_DUPLICATE, //a transaction of the same source and nonce is queued
+			INSERT_FULL, //max_count transactions are queued
+			INSERT_BAD_SEQ //the nonce is not above the nonce on chain the queue knows of the source
+		};
+
+		bool Has(const std::string &address, int64_t nonce);
+		//max_count bounds the whole queue, the concurrent inserts of all shards included
+		InsertResult Insert(const TransactionFrm::pointer &tx, int64_t max_count);
+		int64_t Size() const;
+
+		//up to max_count consecutive transactions of the ready accounts within max_bytes, the highest fee and then the oldest
+		//first, merged over the ready indexes of the shards so it costs what it takes; they come out ordered by source address
+		//and nonce, as a txset wants them. The accounts whose nonce was loaded before ledger lcl_seq reload it first, outside
+		//the locks, so the ledgers closed by synchronization neither stall nor leave them stale; transactions under the
+		//reloaded nonce go to stale_txs
+		void GetReady(int64_t lcl_seq, int64_t max_count, int64_t max_bytes,
+			std::vector<TransactionFrm::pointer> &ready_txs, std::vector<TransactionFrm::pointer> &stale_txs);
+		//the transactions a txset rejected as too old, their nonce is on chain already
+		void Remove(const std::vector<TransactionFrm::pointer> &txs);
+		//drops the queued transactions a closed txset contained, returns their number. The apply may have dropped some,
+		//so the nonces of its sources are read again from the db by the next GetReady
+		size_t RemoveCommitted(const protocol::TransactionEnvSet &txset);
+		//the transactions received before expire_time, found by the incoming time index of each shard,
+		//so a tick costs what expires rather than a walk of the whole queue
+		void RemoveTimeout(int64_t expire_time, std::vector<TransactionFrm::pointer> &timeout_txs);
+
+	private:
+		typedef std::multimap<int64_t, TransactionFrm::pointer> ExpiryIndex; //incoming time to transaction
+		//the higher fee first, then the earlier received; source and nonce settle the ties
+		struct Priority {
+			bool operator()(const TransactionFrm::pointer &a, const TransactionFrm::pointer &b) const;
+		};
+		typedef std::set<TransactionFrm::pointer, Priority> ReadyIndex;
+		struct QueuedTx {
+			TransactionFrm::pointer tx_;
+			ExpiryIndex::iterator expiry_;
+		};
+
+		struct AccountQueue {
+			AccountQueue() :chain_nonce_(-1), nonce_seq_(-1) {}
+			std::map<int64_t, QueuedTx> txs_;
+			TransactionFrm::pointer ready_head_; //the first transaction, while the account is in the ready index
+			int64_t chain_nonce_; //-1 until loaded
+			int64_t nonce_seq_; //the ledger chain_nonce_ was loaded at, -1 to load it again
+
+			bool IsReady() const {
+				return chain_nonce_ >= 0 && !txs_.empty() && txs_.begin()->first == chain_nonce_ + 1;
+			}
+		};
+
+		static const size_t SHARD_COUNT = 16;
+		struct Shard {
+			utils::Mutex mutex_;
+			std::unordered_map<std::string, AccountQueue> accounts_;
+			ReadyIndex ready_; //the first transaction of each ready account
+			std::unordered_set<std::string> waiting_; //the accounts which are not ready
+			ExpiryIndex expiry_; //every queued transaction of the shard, oldest first
+		};
+		Shard shards_[SHARD_COUNT];
+		volatile int64_t size_;
+
+		Shard &GetShard(const std::string &address);
+		//erases a queued transaction together with its index entry
+		void EraseTx(Shard &shard, AccountQueue &account, std::map<int64_t, QueuedTx>::iterator tx_iter);
+		//drops the transactions under the chain nonce into removed, then files the account as ready or not, or erases it once empty
+		void UpdateAccount(Shard &shard, std::unordered_map<std::string, AccountQueue>::iterator iter, std::vector<TransactionFrm::pointer> *removed);
+	};
+}
+
+#endif
@@ -1,4 +1,5 @@
 
+#include <ledger/ledger_manager.h>
 #include "transaction_set.h"
 
 namespace bubi {
@@ -57,11 +58,19 @@ namespace bubi {
 			return 0;
 		}
 
+		//the validity decides a vote, so every signature is checked exactly, on the apply threads which are idle between two ledgers
+		std::vector<TransactionFrm::pointer> txs;
+		for (int32_t i = 0; i < raw_txs_.txs_size(); i++) {
+			txs.push_back(std::make_shared<TransactionFrm>(raw_txs_.txs(i), false));
+		}
+		LedgerManager &ledger_manager = LedgerManager::Instance();
+		TransactionFrm::VerifySignatures(txs, ledger_manager.apply_thread_count_ > 1 ? &ledger_manager.apply_pool_ : NULL, true);
+
 		std::string last_address;
 		int64_t last_seq = -1;
 		for (int32_t i = 0; i < raw_txs_.txs_size(); i++) {
 			const protocol::TransactionEnv &env = raw_txs_.txs(i);
-			TransactionFrm tx(env);
+			TransactionFrm &tx = *txs[i];
 			if (!tx.CheckValid(-1)) {
 				LOG_ERROR("Check txset failed");
 				return false;
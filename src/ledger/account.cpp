@@ -161,13 +161,22 @@ namespace bubi {
 		result = bubi::Proto2Json(account_info_);
 	}
 
+	KVTrieCache::EntryPointer AccountFrm::GetSubTrie(const char *type_prefix, bool update){
+		std::string prefix = ComposePrefix(type_prefix, utils::String::HexStringToBin(account_info_.address()));
+		KVTrieCache *cache = LedgerManager::Instance().account_trie_cache_;
+		if (cache != NULL){
+			return update ? cache->GetForUpdate(prefix) : cache->Get(prefix);
+		}
+		return std::make_shared<KVTrieCache::Entry>(prefix);
+	}
+
 	void AccountFrm::GetAllAssets(std::vector<protocol::Asset>& assets){
-		KVTrie trie;
-		auto batch = std::make_shared<WRITE_BATCH>();
-		std::string prefix = ComposePrefix(General::ASSET_PREFIX, utils::String::HexStringToBin(account_info_.address()));
-		trie.Init(Storage::Instance().account_db(), batch, prefix, 1);
 		std::vector<std::string> values;
-		trie.GetAll("", values);
+		do {
+			KVTrieCache::EntryPointer entry = GetSubTrie(General::ASSET_PREFIX, false);
+			utils::MutexGuard guard(entry->mutex_);
+			entry->GetTrie().GetAll("", values);
+		} while (false);
 		for (size_t i = 0; i < values.size(); i++){
 			protocol::Asset asset;
 			asset.ParseFromString(values[i]);
@@ -176,12 +185,12 @@ namespace bubi {
 	}
 
 	void AccountFrm::GetAllMetaData(std::vector<protocol::KeyPair>& metadata){
-		KVTrie trie;
-		auto batch = std::make_shared<WRITE_BATCH>();
-		std::string prefix = ComposePrefix(General::METADATA_PREFIX, utils::String::HexStringToBin(account_info_.address()));
-		trie.Init(Storage::Instance().account_db(), batch, prefix, 1);
 		std::vector<std::string> values;
-		trie.GetAll("", values);
+		do {
+			KVTrieCache::EntryPointer entry = GetSubTrie(General::METADATA_PREFIX, false);
+			utils::MutexGuard guard(entry->mutex_);
+			entry->GetTrie().GetAll("", values);
+		} while (false);
 		for (size_t i = 0; i < values.size(); i++){
 			protocol::KeyPair asset;
 			asset.ParseFromString(values[i]);
@@ -191,7 +200,8 @@ namespace bubi {
 
 	bool AccountFrm::GetAsset(const protocol::AssetProperty &asset_property, protocol::Asset& asset){
 		//LOG_INFO("%p GetAsset", this);
-		auto it = assets_.find(asset_property);
+		AssetKey asset_key(asset_property);
+		auto it = assets_.find(asset_key);
 		if (it != assets_.end()){
 			if (it->second.action_ == utils::DEL){
 				return false;
@@ -200,17 +210,14 @@ namespace bubi {
 			return true;
 		}
 
-		auto batch = std::make_shared<WRITE_BATCH>();
-		std::string asset_prefix = ComposePrefix(General::ASSET_PREFIX, utils::String::HexStringToBin(account_info_.address()));
-		KVTrie trie;
-		trie.Init(Storage::Instance().account_db(), batch, asset_prefix, 1);
-
-		auto asset_key = asset_property.SerializeAsString();
 		std::string buff;
-	
-		if (!trie.Get(asset_key, buff)){
-			return false;
-		}
+		do {
+			KVTrieCache::EntryPointer entry = GetSubTrie(General::ASSET_PREFIX, false);
+			utils::MutexGuard guard(entry->mutex_);
+			if (!entry->GetTrie().Get(asset_key.key(), buff)){
+				return false;
+			}
+		} while (false);
 
 		DataCache<protocol::Asset> Rec;
 		Rec.action_ = utils::MOD;
@@ -219,7 +226,7 @@ namespace bubi {
 			BUBI_EXIT("fatal error,Asset ParseFromString fail, data may damaged");
 		}
 		Rec.data_.CopyFrom(asset);
-		assets_.insert({ asset_property, Rec });
+		assets_.insert({ asset_key, Rec });
 		return true;
 	}
 
@@ -227,7 +234,7 @@ namespace bubi {
 		DataCache<protocol::Asset> Rec;
 		Rec.action_ = utils::ADD;
 		Rec.data_.CopyFrom(data_ptr);
-		assets_[data_ptr.property()] = Rec;
+		assets_[AssetKey(data_ptr.property())] = Rec;
 	}
 
 	//
@@ -242,15 +249,14 @@ namespace bubi {
 			return true;
 		}
 
-		auto batch = std::make_shared<WRITE_BATCH>();
-		KVTrie trie;
-		std::string prefix =  ComposePrefix(General::METADATA_PREFIX, utils::String::HexStringToBin(account_info_.address()));
-		trie.Init(Storage::Instance().account_db(), batch, prefix, 1);
-
 		std::string buff;
-		if (!trie.Get(binkey, buff)){
-			return false;
-		}
+		do {
+			KVTrieCache::EntryPointer entry = GetSubTrie(General::METADATA_PREFIX, false);
+			utils::MutexGuard guard(entry->mutex_);
+			if (!entry->GetTrie().Get(binkey, buff)){
+				return false;
+			}
+		} while (false);
 		
 		if (!keypair_ptr.ParseFromString(buff)){
 			BUBI_EXIT("fatal error,Asset ParseFromString fail, data may damaged");
@@ -295,59 +301,68 @@ namespace bubi {
 	}
 
 	void AccountFrm::UpdateHash(std::shared_ptr<WRITE_BATCH> batch){
-		KVTrie trie_asset;
-		std::string asset_prefix = ComposePrefix(General::ASSET_PREFIX, utils::String::HexStringToBin(account_info_.address()));
-		trie_asset.Init(Storage::Instance().account_db(), batch, asset_prefix, 1);
-
-		KVTrie trie_metadata;
-		std::string meta_prefix = ComposePrefix(General::METADATA_PREFIX, utils::String::HexStringToBin(account_info_.address()));
-		trie_metadata.Init(Storage::Instance().account_db(), batch, meta_prefix, 1);
-
-		auto& map = assets_;
-		for (auto it = map.begin(); it != map.end(); it++){
-			auto action = it->second.action_;
-			auto asset = it->second.data_;
-			Json::Value tmp = Proto2Json(asset);
-			switch (action)
-			{
-			case utils::ChangeAction::ADD:
-			case utils::ChangeAction::MOD:
-				if (asset.amount() == 0)
-					trie_asset.Delete(asset.property().SerializeAsString());
-				else
-					trie_asset.Set(asset.property().SerializeAsString(), asset.SerializeAsString());
-				break;
-			case utils::ChangeAction::DEL:
-				trie_asset.Delete(asset.property().SerializeAsString());
-				break;
-
-			default:
-				break;
+		do {
+			KVTrieCache::EntryPointer entry = GetSubTrie(General::ASSET_PREFIX, true);
+			utils::MutexGuard guard(entry->mutex_);
+			KVTrie &trie_asset = entry->GetTrie();
+			trie_asset.batch_ = batch;
+
+			auto& map = assets_;
+			for (auto it = map.begin(); it != map.end(); it++){
+				auto action = it->second.action_;
+				const protocol::Asset &asset = it->second.data_;
+				switch (action)
+				{
+				case utils::ChangeAction::ADD:
+				case utils::ChangeAction::MOD:
+					if (asset.amount() == 0)
+						trie_asset.Delete(it->first.key());
+					else
+						trie_asset.Set(it->first.key(), asset.SerializeAsString());
+					break;
+				case utils::ChangeAction::DEL:
+					trie_asset.Delete(it->first.key());
+					break;
+
+				default:
+					break;
+				}
 			}
-		}
-		trie_asset.UpdateHash();
-		account_info_.set_assets_hash(trie_asset.GetRootHash());
-		
-		for (auto it = metadata_.begin(); it != metadata_.end(); it++){
-			auto action = it->second.action_;
-			auto kp = it->second.data_;
-
-			switch (action)
-			{
-			case utils::ADD:
-			case utils::MOD:
-				trie_metadata.Set(it->first, kp.SerializeAsString());
-				break;
-			case utils::DEL:
-				trie_metadata.Delete(it->first);
-				break;
-
-			default:
-				break;
+			trie_asset.UpdateHash();
+			account_info_.set_assets_hash(trie_asset.GetRootHash());
+			trie_asset.batch_ = std::make_shared<WRITE_BATCH>();
+			trie_asset.FreeMemory(KVTrieCache::TRIE_DEPTH + 1);
+		} while (false);
+
+		do {
+			KVTrieCache::EntryPointer entry = GetSubTrie(General::METADATA_PREFIX, true);
+			utils::MutexGuard guard(entry->mutex_);
+			KVTrie &trie_metadata = entry->GetTrie();
+			trie_metadata.batch_ = batch;
+
+			for (auto it = metadata_.begin(); it != metadata_.end(); it++){
+				auto action = it->second.action_;
+				auto kp = it->second.data_;
+
+				switch (action)
+				{
+				case utils::ADD:
+				case utils::MOD:
+					trie_metadata.Set(it->first, kp.SerializeAsString());
+					break;
+				case utils::DEL:
+					trie_metadata.Delete(it->first);
+					break;
+
+				default:
+					break;
+				}
 			}
-		}
-		trie_metadata.UpdateHash();
-		account_info_.set_metadatas_hash(trie_metadata.GetRootHash());
+			trie_metadata.UpdateHash();
+			account_info_.set_metadatas_hash(trie_metadata.GetRootHash());
+			trie_metadata.batch_ = std::make_shared<WRITE_BATCH>();
+			trie_metadata.FreeMemory(KVTrieCache::TRIE_DEPTH + 1);
+		} while (false);
 	}
 
 	void AccountFrm::NonceIncrease(){
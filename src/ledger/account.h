@@ -12,9 +12,18 @@
 #include "kv_trie.h"
 namespace bubi {
 
-	struct AssetSort {
-		bool operator() (const protocol::AssetProperty& a, const protocol::AssetProperty& b)const{
-			return a.SerializeAsString() < b.SerializeAsString();
+	//map key of an asset, the property is serialized once and the bytes are also the asset trie key
+	class AssetKey {
+		std::string key_;
+	public:
+		explicit AssetKey(const protocol::AssetProperty& property) : key_(property.SerializeAsString()) {}
+
+		const std::string &key() const {
+			return key_;
+		}
+
+		bool operator<(const AssetKey& other) const {
+			return key_ < other.key_;
 		}
 	};
 
@@ -100,9 +109,12 @@ namespace bubi {
 			T data_;
 		};
 
-		std::map<protocol::AssetProperty, DataCache<protocol::Asset>, AssetSort> assets_;
+		std::map<AssetKey, DataCache<protocol::Asset>> assets_;
 		std::map<std::string, DataCache<protocol::KeyPair>> metadata_;
 	private:
+		//update: the trie UpdateHash changes, kept in the cache and pinned until the ledger is staged
+		KVTrieCache::EntryPointer GetSubTrie(const char *type_prefix, bool update);
+
 		protocol::Account	account_info_;
 	};
 
@@ -9,35 +9,56 @@ namespace bubi{
 	Environment::Environment(Environment* parent){
 		utils::AtomicInc(&bubi::General::env_new_count);
 		parent_ = parent;
-		if (parent_){
-			for (auto it = parent_->entries_.begin(); it != parent_->entries_.end(); it++){
-				entries_[it->first] = std::make_shared<AccountFrm>(it->second);
-			}
-		}
 	}
 	
 	Environment::~Environment() {
 		utils::AtomicInc(&bubi::General::env_delete_count);
 	}
 
-	bool Environment::GetEntry(const std::string &key, AccountFrm::pointer &frm){
-		if (entries_.find(key) == entries_.end()){
-			if (AccountFromDB(key, frm)){
-				entries_[key] = frm;
+	bool Environment::FindEntry(const std::string &key, AccountFrm::pointer &frm){
+		for (Environment *env = this; env != nullptr; env = env->parent_){
+			auto it = env->entries_.find(key);
+			if (it != env->entries_.end()){
+				frm = it->second;
 				return true;
 			}
-			else{
-				return false;
-			}
 		}
-		else{
-			frm = entries_[key];
+		return false;
+	}
+
+	bool Environment::GetEntry(const std::string &key, AccountFrm::pointer &frm){
+		auto it = entries_.find(key);
+		if (it != entries_.end()){
+			frm = it->second;
 			return true;
 		}
+
+		AccountFrm::pointer base = nullptr;
+		if (parent_ && parent_->FindEntry(key, base)){
+			frm = std::make_shared<AccountFrm>(base);
+		}
+		else if (!AccountFromDB(key, frm)){
+			return false;
+		}
+
+		entries_[key] = frm;
+		return true;
+	}
+
+	bool Environment::PeekEntry(const std::string &key, AccountFrm::pointer &frm){
+		if (FindEntry(key, frm)){
+			return true;
+		}
+		return AccountFromDB(key, frm);
 	}
 
 	void Environment::Commit(){
-		parent_->entries_ = entries_;
+		if (parent_ == nullptr){
+			return;
+		}
+		for (auto it = entries_.begin(); it != entries_.end(); it++){
+			parent_->entries_[it->first] = it->second;
+		}
 	}
 
 	bool Environment::AddEntry(const std::string& key, AccountFrm::pointer frm){
@@ -47,12 +68,15 @@ namespace bubi{
 
 	bool Environment::AccountFromDB(const std::string &address, AccountFrm::pointer &account_ptr){
 
-		auto db = Storage::Instance().account_db();
 		std::string index = utils::String::HexStringToBin(address);
 		std::string buff;
-		if (!LedgerManager::Instance().tree_->Get(index, buff)){
-			return false;
-		}
+		do {
+			//the trie caches the nodes it walks through, so the lookups are serialized
+			utils::MutexGuard guard(LedgerManager::Instance().tree_mutex_);
+			if (!LedgerManager::Instance().tree_->Get(index, buff)){
+				return false;
+			}
+		} while (false);
 
 		protocol::Account account;
 		if (!account.ParseFromString(buff)){
@@ -58,10 +58,20 @@ namespace bubi {
 
 		Environment(Environment *parent);
 		~Environment();
+
+		//copy on write, the entry is copied from the parent layers (or loaded from db) on first access
 		bool GetEntry(const std::string& key, AccountFrm::pointer &frm);
 		bool AddEntry(const std::string& key, AccountFrm::pointer frm);
+
+		//look up the entry without copying it into this layer, the result must not be modified
+		bool PeekEntry(const std::string& key, AccountFrm::pointer &frm);
+
+		//merge the entries of this layer into the parent
 		void Commit();
 		static bool AccountFromDB(const std::string &address, AccountFrm::pointer &account_ptr);
+	private:
+		//look up the entry in this layer and its ancestors, never copy or load
+		bool FindEntry(const std::string& key, AccountFrm::pointer &frm);
 	};
 }
 #endif
@@ -3,10 +3,240 @@
 
 namespace bubi{
 
-	KVTrie::KVTrie(){
+	TrieNodeCache::TrieNodeCache(size_t max_bytes)
+		:max_bytes_(max_bytes), bytes_(0), hit_count_(0), miss_count_(0){
+	}
+
+	TrieNodeCache::~TrieNodeCache(){
+	}
+
+	void TrieNodeCache::Remove(std::unordered_map<std::string, ItemList::iterator>::iterator it){
+		bytes_ -= it->first.size() + it->second->second.size();
+		items_.erase(it->second);
+		index_.erase(it);
+	}
+
+	bool TrieNodeCache::Get(const std::string& key, std::string& buff){
+		utils::MutexGuard guard(mutex_);
+		auto it = index_.find(key);
+		if (it == index_.end()){
+			miss_count_++;
+			return false;
+		}
+
+		items_.splice(items_.begin(), items_, it->second);
+		buff = it->second->second;
+		hit_count_++;
+		return true;
+	}
+
+	void TrieNodeCache::Put(const std::string& key, const std::string& buff){
+		utils::MutexGuard guard(mutex_);
+		auto it = index_.find(key);
+		if (it != index_.end()){
+			Remove(it);
+		}
+
+		size_t size = key.size() + buff.size();
+		if (size > max_bytes_){
+			return;
+		}
+
+		items_.push_front(std::make_pair(key, buff));
+		index_[key] = items_.begin();
+		bytes_ += size;
+
+		while (bytes_ > max_bytes_){
+			Remove(index_.find(items_.back().first));
+		}
+	}
+
+	void TrieNodeCache::Erase(const std::string& key){
+		utils::MutexGuard guard(mutex_);
+		auto it = index_.find(key);
+		if (it != index_.end()){
+			Remove(it);
+		}
+	}
+
+	int64_t TrieNodeCache::hit_count(){
+		utils::MutexGuard guard(mutex_);
+		return hit_count_;
+	}
+
+	int64_t TrieNodeCache::miss_count(){
+		utils::MutexGuard guard(mutex_);
+		return miss_count_;
+	}
+
+	void TrieNodeCache::GetModuleStatus(Json::Value &data){
+		utils::MutexGuard guard(mutex_);
+		data["max_bytes"] = (Json::UInt64)max_bytes_;
+		data["bytes"] = (Json::UInt64)bytes_;
+		data["count"] = (Json::UInt64)index_.size();
+		data["hit"] = hit_count_;
+		data["miss"] = miss_count_;
+	}
+
+	KVTrieCache::Entry::Entry(const std::string& prefix) :prefix_(prefix), inited_(false){
+	}
+
+	KVTrieCache::Entry::~Entry(){
+	}
+
+	KVTrie& KVTrieCache::Entry::GetTrie(){
+		if (!inited_){
+			trie_.Init(Storage::Instance().account_db(), std::make_shared<WRITE_BATCH>(), prefix_, TRIE_DEPTH);
+			inited_ = true;
+		}
+		return trie_;
+	}
+
+	KVTrieCache::KVTrieCache(size_t max_count) :entries_(max_count), hit_count_(0), miss_count_(0){
+	}
+
+	KVTrieCache::~KVTrieCache(){
+	}
+
+	KVTrieCache::EntryPointer KVTrieCache::Get(const std::string& prefix){
+		utils::MutexGuard guard(mutex_);
+		EntryPointer entry;
+		if (entries_.get(prefix, entry)){
+			hit_count_++;
+			return entry;
+		}
+
+		std::unordered_map<std::string, EntryPointer>::iterator iter = pinned_.find(prefix);
+		if (iter != pinned_.end()){
+			hit_count_++;
+			return iter->second;
+		}
+
+		miss_count_++;
+		return std::make_shared<Entry>(prefix);
+	}
+
+	KVTrieCache::EntryPointer KVTrieCache::GetForUpdate(const std::string& prefix){
+		utils::MutexGuard guard(mutex_);
+		EntryPointer entry;
+		if (entries_.get(prefix, entry)){
+			hit_count_++;
+		}
+		else{
+			std::unordered_map<std::string, EntryPointer>::iterator iter = pinned_.find(prefix);
+			if (iter != pinned_.end()){
+				hit_count_++;
+				entry = iter->second;
+			}
+			else{
+				miss_count_++;
+				entry = std::make_shared<Entry>(prefix);
+			}
+			entries_.put(prefix, entry);
+		}
+
+		pinned_[prefix] = entry;
+		return entry;
+	}
+
+	void KVTrieCache::Unpin(){
+		utils::MutexGuard guard(mutex_);
+		pinned_.clear();
+	}
+
+	void KVTrieCache::GetModuleStatus(Json::Value &data){
+		utils::MutexGuard guard(mutex_);
+		data["count"] = (Json::UInt64)entries_.size();
+		data["pinned"] = (Json::UInt64)pinned_.size();
+		data["hit"] = hit_count_;
+		data["miss"] = miss_count_;
+	}
+
+	KVTrie::KVTrie() :mdb_(NULL), cache_(NULL), pool_(NULL), time_(0){
 		//leafcount_ = 0;
 	}
 
+	void KVTrie::SetCache(TrieNodeCache* cache){
+		cache_ = cache;
+	}
+
+	void KVTrie::SetThreadPool(utils::ThreadPool* pool){
+		pool_ = pool;
+	}
+
+	//hashes one branch of the root into its own batch
+	class UpdateHashTask : public utils::Runnable {
+	public:
+		KVTrie trie_;
+		NodeFrm::POINTER node_;
+		NodeChild result_;
+		utils::Semaphore *done_;
+
+		virtual void Run(utils::Thread *this_thread) override {
+			result_ = trie_.UpdateNodeHash(node_);
+			done_->Signal();
+		}
+	};
+
+	class BatchAppender : public WRITE_BATCH::Handler {
+		WRITE_BATCH *batch_;
+	public:
+		BatchAppender(WRITE_BATCH *batch) :batch_(batch) {}
+
+		virtual void Put(const SLICE& key, const SLICE& value) override {
+			batch_->Put(key, value);
+		}
+
+		virtual void Delete(const SLICE& key) override {
+			batch_->Delete(key);
+		}
+	};
+
+	void KVTrie::UpdateHash(){
+		std::vector<std::shared_ptr<UpdateHashTask>> tasks(16);
+		size_t task_count = 0;
+		for (int i = 0; pool_ != NULL && i < 16; i++){
+			NodeFrm::POINTER child = root_->children_[i].get();
+			if (child == nullptr || !child->modified_){
+				continue;
+			}
+
+			std::shared_ptr<UpdateHashTask> task = std::make_shared<UpdateHashTask>();
+			task->trie_.mdb_ = mdb_;
+			task->trie_.prefix_ = prefix_;
+			task->trie_.cache_ = cache_;
+			task->trie_.batch_ = std::make_shared<WRITE_BATCH>();
+			task->node_ = child;
+			tasks[i] = task;
+			task_count++;
+		}
+
+		if (task_count > 1){
+			utils::Semaphore done;
+			for (int i = 0; i < 16; i++){
+				if (tasks[i]){
+					tasks[i]->done_ = &done;
+					pool_->AddTask(tasks[i].get());
+				}
+			}
+
+			for (size_t i = 0; i < task_count; i++){
+				while (!done.Wait()) {}
+			}
+
+			//merge in branch order so that the batch is the same as the serial one
+			BatchAppender appender(batch_.get());
+			for (int i = 0; i < 16; i++){
+				if (tasks[i]){
+					root_->SetChildInfo(i, tasks[i]->result_);
+					tasks[i]->trie_.batch_->Iterate(&appender);
+				}
+			}
+		}
+
+		Trie::UpdateHash();
+	}
+
 	KVTrie::~KVTrie(){
 		FreeMemory(0);
 	}
@@ -16,14 +246,12 @@ namespace bubi{
 		mdb_ = db;
 		prefix_ = prefix;
 		batch_ = batch;
-		Location location;
-		location.push_back(0);
-		root_ = std::make_shared< NodeFrm>(location);
+		root_.reset(new NodeFrm(rootl));
 
 		protocol::Node info;
-		if (storage_load(location, info)){
-			root_->info_.CopyFrom(info);
-			Load(root_, depth);
+		if (storage_load(rootl.ToLocation(), info)){
+			root_->FromProto(info);
+			Load(root_.get(), depth);
 		}
 		return true;
 	}
@@ -51,22 +279,30 @@ namespace bubi{
 	}
 
 	void KVTrie::StorageSaveNode(NodeFrm::POINTER node) {
-		std::string buff = node->info_.SerializeAsString();
-		std::string key = Location2DBkey(node->location_, false);
+		std::string buff = node->Serialize();
+		std::string key = Location2DBkey(node->location_.ToLocation(), false);
 		batch_->Put(key, buff);
+		if (cache_){
+			cache_->Put(key, buff);
+		}
 		LOG_DEBUG("save INNER(%s)", utils::String::BinToHexString(key).c_str());
 	}
 
 	void  KVTrie::StorageSaveLeaf(NodeFrm::POINTER node){
-		std::string key = Location2DBkey(node->location_, true);
+		std::string key = Location2DBkey(node->location_.ToLocation(), true);
 		batch_->Put(key, *node->leaf_);
 		LOG_DEBUG("save LEAF(%s)", utils::String::BinToHexString(key).c_str());
 	}
 
 	bool KVTrie::storage_load(const Location& location, protocol::Node& info)  {
-		int64_t t1 = utils::Timestamp::HighResolution();
 		std::string key = Location2DBkey(location, false);
 		std::string buff;
+		if (cache_ && cache_->Get(key, buff)){
+			info.ParseFromString(buff);
+			return true;
+		}
+
+		int64_t t1 = utils::Timestamp::HighResolution();
 		LOG_DEBUG("LOAD INNER:%s", utils::String::BinToHexString(key).c_str());
 		int32_t stat = mdb_->Get(key, buff);
 		int64_t t2 = utils::Timestamp::HighResolution();
@@ -74,6 +310,9 @@ namespace bubi{
 		time_ += (t2 - t1);
 
 		if (stat == 1){
+			if (cache_){
+				cache_->Put(key, buff);
+			}
 			info.ParseFromString(buff);
 			return true;
 		}
@@ -84,14 +323,57 @@ namespace bubi{
 		}
 	}
 
+	void KVTrie::storage_multi_load(const std::vector<Location>& locations, std::vector<protocol::Node>& infos, std::vector<bool>& founds){
+		infos.resize(locations.size());
+		founds.resize(locations.size());
+
+		std::vector<std::string> keys;
+		std::vector<size_t> indexes;
+		for (size_t i = 0; i < locations.size(); i++){
+			std::string key = Location2DBkey(locations[i], false);
+			std::string buff;
+			if (cache_ && cache_->Get(key, buff)){
+				founds[i] = infos[i].ParseFromString(buff);
+				continue;
+			}
+			keys.push_back(key);
+			indexes.push_back(i);
+		}
+
+		if (keys.empty()){
+			return;
+		}
+
+		int64_t t1 = utils::Timestamp::HighResolution();
+		std::vector<std::string> values;
+		std::vector<int32_t> results;
+		if (!mdb_->MultiGet(keys, values, results)){
+			BUBI_EXIT("database read failed. %s", mdb_->error_desc().c_str());
+		}
+		time_ += (utils::Timestamp::HighResolution() - t1);
+
+		for (size_t i = 0; i < keys.size(); i++){
+			founds[indexes[i]] = results[i] == 1;
+			if (results[i] == 1){
+				if (cache_){
+					cache_->Put(keys[i], values[i]);
+				}
+				infos[indexes[i]].ParseFromString(values[i]);
+			}
+		}
+	}
+
 	void KVTrie::StorageDeleteNode(NodeFrm::POINTER node) {
-		std::string key = Location2DBkey(node->location_, false);
+		std::string key = Location2DBkey(node->location_.ToLocation(), false);
 		LOG_DEBUG("DELETE INNER %s", utils::String::BinToHexString(key).c_str());
 		batch_->Delete(key);
+		if (cache_){
+			cache_->Erase(key);
+		}
 	}
 
 	void KVTrie::StorageDeleteLeaf(NodeFrm::POINTER node){
-		std::string key = Location2DBkey(node->location_, true);
+		std::string key = Location2DBkey(node->location_.ToLocation(), true);
 		LOG_DEBUG("DELETE LEAF %s", utils::String::BinToHexString(key).c_str());
 		batch_->Delete(key);
 	}
@@ -111,6 +393,22 @@ namespace bubi{
 		}
 	}
 
+	void KVTrie::GetAll(const std::string& key, std::vector<std::string>& values){
+		//a leaf is stored under its full key and deleted with it, so the leaf keys
+		//starting with key are the stored items, in the order the node walk visits them
+		KeyValueDbIterator::Options options;
+		options.prefix_ = Location2DBkey(NibblePath::FromKey(key).ToLocation(), true);
+		options.fill_cache_ = false;
+		KeyValueDbIteratorPtr iter = mdb_->NewIterator(options);
+		for (; iter->Valid(); iter->Next()){
+			values.push_back(iter->value());
+		}
+	}
+
+	void KVTrie::HashCryptoMulti(const std::vector<const std::string*>& inputs, std::vector<std::string>& outputs){
+		HashWrapper::CryptoMulti(inputs, outputs);
+	}
+
 	std::string KVTrie::HashCrypto(const std::string& input){
 		return HashWrapper::Crypto(input);
 	}
@@ -2,14 +2,43 @@
 #ifndef KV_TRIE_H_
 #define KV_TRIE_H_
 
+#include <utils/lrucache.hpp>
 #include <common/storage.h>
 #include "trie.h"
 
 namespace bubi{
 
+	//lru cache of serialized inner nodes keyed by db key, bounded by bytes and kept across ledgers
+	class TrieNodeCache{
+		typedef std::list<std::pair<std::string, std::string>> ItemList;
+		ItemList items_;
+		std::unordered_map<std::string, ItemList::iterator> index_;
+		size_t max_bytes_;
+		size_t bytes_;
+		int64_t hit_count_;
+		int64_t miss_count_;
+		utils::Mutex mutex_;
+
+		void Remove(std::unordered_map<std::string, ItemList::iterator>::iterator it);
+	public:
+		TrieNodeCache(size_t max_bytes);
+		~TrieNodeCache();
+
+		bool Get(const std::string& key, std::string& buff);
+		void Put(const std::string& key, const std::string& buff);
+		void Erase(const std::string& key);
+
+		int64_t hit_count();
+		int64_t miss_count();
+		void GetModuleStatus(Json::Value &data);
+	};
+
 	class KVTrie :public Trie{
+		friend class UpdateHashTask;
 		KeyValueDb* mdb_;
 		std::string prefix_;
+		TrieNodeCache* cache_;
+		utils::ThreadPool* pool_;
 	public:
 		std::shared_ptr<WRITE_BATCH> batch_;
 		int64_t time_;
@@ -18,6 +47,17 @@ namespace bubi{
 		~KVTrie();
 		bool Init(bubi::KeyValueDb* db, std::shared_ptr<WRITE_BATCH>, const std::string& prefix, int depth);
 
+		//must be set before Init, the cache is not owned by the trie
+		void SetCache(TrieNodeCache* cache);
+
+		//modified branches of the root are hashed on the pool, the pool is not owned by the trie
+		void SetThreadPool(utils::ThreadPool* pool);
+
+		virtual void UpdateHash() override;
+
+		//scan the stored leaves under key instead of walking the nodes
+		virtual void GetAll(const std::string& key, std::vector<std::string>& values) override;
+
 		//int LeafCount();
 		bool AddToDB();
 	private:
@@ -31,8 +71,49 @@ namespace bubi{
 		virtual void StorageDeleteLeaf(NodeFrm::POINTER node) override;
 
 		virtual bool storage_load(const Location& location, protocol::Node& info) override;
+		virtual void storage_multi_load(const std::vector<Location>& locations, std::vector<protocol::Node>& infos, std::vector<bool>& founds) override;
 		virtual bool StorageGetLeaf(const Location& location, std::string& value)override;
 		virtual std::string HashCrypto(const std::string& input) override;
+		virtual void HashCryptoMulti(const std::vector<const std::string*>& inputs, std::vector<std::string>& outputs) override;
+	};
+
+	//asset and metadata tries of accounts, kept across ledgers and bounded by count
+	class KVTrieCache{
+	public:
+		static const int TRIE_DEPTH = 1;
+
+		class Entry{
+			std::string prefix_;
+			bool inited_;
+			KVTrie trie_;
+		public:
+			utils::Mutex mutex_;
+
+			Entry(const std::string& prefix);
+			~Entry();
+
+			//the mutex must be held, the trie is loaded on first use
+			KVTrie& GetTrie();
+		};
+		typedef std::shared_ptr<Entry> EntryPointer;
+	private:
+		cache::lru_cache<std::string, EntryPointer> entries_;
+		//changed by the closing ledger, their nodes are only in its batch until CloseLedger stages it
+		std::unordered_map<std::string, EntryPointer> pinned_;
+		int64_t hit_count_;
+		int64_t miss_count_;
+		utils::Mutex mutex_;
+	public:
+		KVTrieCache(size_t max_count);
+		~KVTrieCache();
+
+		//a miss gives a trie loaded from the db that is not kept
+		EntryPointer Get(const std::string& prefix);
+		//the trie a ledger changes, kept and pinned until Unpin
+		EntryPointer GetForUpdate(const std::string& prefix);
+		//the batch of the closed ledger is staged, the db reads give what the pinned tries hold
+		void Unpin();
+		void GetModuleStatus(Json::Value &data);
 	};
 }
 
@@ -42,6 +42,16 @@ namespace bubi {
 
 
 	bool LedgerFrm::AddToDb(WRITE_BATCH &batch) {
+		FillDbBatch(batch);
+
+		KeyValueDb *db = Storage::Instance().ledger_db();
+		if (!db->WriteBatch(batch)){
+			BUBI_EXIT("Write ledger and transaction failed(%s)", db->error_desc().c_str());
+		}
+		return true;
+	}
+
+	void LedgerFrm::FillDbBatch(WRITE_BATCH &batch) {
 		KeyValueDb *db = Storage::Instance().ledger_db();
 
 		batch.Put(bubi::General::KEY_LEDGER_SEQ, utils::String::ToString(ledger_.header().seq()));
@@ -107,46 +117,343 @@ namespace bubi {
 
 			batch.Put(General::LAST_TX_HASHS, new_last_hashs.SerializeAsString());
 		}
+	}
 
-		if (!db->WriteBatch(batch)){
-			BUBI_EXIT("Write ledger and transaction failed(%s)", db->error_desc().c_str());
+	//applies a group of transactions which has no account in common with the other groups
+	class ApplyGroupTask : public utils::Runnable {
+	public:
+		LedgerFrm *ledger_;
+		std::vector<int32_t> indexes_;
+		std::shared_ptr<Environment> environment_;
+		const std::vector<TransactionFrm::pointer> *tx_frms_;
+		std::vector<bool> applied_;
+		utils::Semaphore *done_;
+
+		virtual void Run(utils::Thread *this_thread) override {
+			for (size_t i = 0; i < indexes_.size(); i++) {
+				applied_.push_back(ledger_->ApplyTransaction((*tx_frms_)[indexes_[i]], environment_, true));
+			}
+			done_->Signal();
 		}
-		return true;
+	};
+
+	//builds a slice of the transactions of a ledger, each one verifies its signatures
+	class CreateTransactionTask : public utils::Runnable {
+	public:
+		const protocol::ConsensusValue *request_;
+		std::vector<TransactionFrm::pointer> *tx_frms_;
+		int32_t begin_;
+		int32_t end_;
+		utils::Semaphore *done_;
+
+		virtual void Run(utils::Thread *this_thread) override {
+			for (int32_t i = begin_; i < end_; i++) {
+				(*tx_frms_)[i] = std::make_shared<TransactionFrm>(request_->txset().txs(i));
+			}
+			done_->Signal();
+		}
+	};
+
+	void LedgerFrm::PrefetchAccounts(const protocol::ConsensusValue& request) {
+		std::set<std::string> addresses;
+		for (int32_t i = 0; i < request.txset().txs_size(); i++) {
+			const protocol::Transaction &tran = request.txset().txs(i).transaction();
+			addresses.insert(tran.source_address());
+			for (int32_t j = 0; j < tran.operations_size(); j++) {
+				const protocol::Operation &ope = tran.operations(j);
+				if (!ope.source_address().empty()) {
+					addresses.insert(ope.source_address());
+				}
+
+				switch (ope.type()) {
+				case protocol::Operation_Type_CREATE_ACCOUNT:
+					addresses.insert(ope.create_account().dest_address());
+					break;
+				case protocol::Operation_Type_PAYMENT:
+					addresses.insert(ope.payment().dest_address());
+					break;
+				case protocol::Operation_Type_PAY_COIN:
+					addresses.insert(ope.pay_coin().dest_address());
+					break;
+				default:
+					break;
+				}
+			}
+		}
+
+		std::vector<std::string> keys;
+		for (auto it = addresses.begin(); it != addresses.end(); it++) {
+			if (PublicKey::IsAddressValid(*it)) {
+				keys.push_back(utils::String::HexStringToBin(*it));
+			}
+		}
+
+		utils::MutexGuard guard(LedgerManager::Instance().tree_mutex_);
+		LedgerManager::Instance().tree_->Prefetch(keys);
 	}
 
 	bool LedgerFrm::Apply(const protocol::ConsensusValue& request)
 	{
 		value_ = std::make_shared<protocol::ConsensusValue>(request);
-		uint32_t success_count = 0;
 		environment_ = std::make_shared<Environment>(nullptr);
+		PrefetchAccounts(request);
+
+		int32_t tx_size = request.txset().txs_size();
+		std::vector<TransactionFrm::pointer> tx_frms(tx_size);
+		std::vector<bool> applied(tx_size, false);
+		bool parallel = LedgerManager::Instance().apply_thread_count_ > 1;
+		CreateTransactions(request, tx_frms);
+
+		//the transactions between two serial ones are applied as a batch of independent groups
+		std::vector<int32_t> batch;
+		std::vector<std::set<std::string>> batch_accounts;
+		for (int32_t i = 0; i < tx_size; i++) {
+			std::set<std::string> accounts;
+			if (parallel && GetConflictAccounts(request.txset().txs(i).transaction(), accounts)) {
+				batch.push_back(i);
+				batch_accounts.push_back(accounts);
+				continue;
+			}
+
+			ApplyBatch(request, batch, batch_accounts, tx_frms, applied);
+			batch.clear();
+			batch_accounts.clear();
 
-		for (int i = 0; i < request.txset().txs_size(); i++) {
-			auto txproto = request.txset().txs(i);
-			
-			TransactionFrm::pointer tx_frm = std::make_shared<TransactionFrm>(txproto);
+			applied[i] = ApplyTransaction(tx_frms[i], environment_, false);
+		}
+		ApplyBatch(request, batch, batch_accounts, tx_frms, applied);
 
-			if (!tx_frm->ValidForApply(environment_)){
-				dropped_tx_frms_.push_back(tx_frm);
+		for (int32_t i = 0; i < tx_size; i++) {
+			if (!applied[i]) {
+				dropped_tx_frms_.push_back(tx_frms[i]);
 				continue;
 			}
+			apply_tx_frms_.push_back(tx_frms[i]);
+			ledger_.add_transaction_envs()->CopyFrom(request.txset().txs(i));
+		}
+
+		return true;
+	}
+
+	void LedgerFrm::CreateTransactions(const protocol::ConsensusValue& request, std::vector<TransactionFrm::pointer> &tx_frms) {
+		//the signatures decide the ledger, each one is verified on its own, never in an ed25519 batch
+		int32_t tx_size = request.txset().txs_size();
+		uint32_t thread_count = LedgerManager::Instance().apply_thread_count_;
+		if (thread_count <= 1 || tx_size < 2) {
+			for (int32_t i = 0; i < tx_size; i++) {
+				tx_frms[i] = std::make_shared<TransactionFrm>(request.txset().txs(i));
+			}
+			return;
+		}
+
+		utils::Semaphore done;
+		int32_t slice_size = (tx_size + thread_count - 1) / thread_count;
+		std::vector<std::shared_ptr<CreateTransactionTask>> tasks;
+		for (int32_t begin = 0; begin < tx_size; begin += slice_size) {
+			std::shared_ptr<CreateTransactionTask> task = std::make_shared<CreateTransactionTask>();
+			task->request_ = &request;
+			task->tx_frms_ = &tx_frms;
+			task->begin_ = begin;
+			task->end_ = std::min(tx_size, begin + slice_size);
+			task->done_ = &done;
+			tasks.push_back(task);
+			LedgerManager::Instance().apply_pool_.AddTask(task.get());
+		}
+
+		for (size_t i = 0; i < tasks.size(); i++) {
+			while (!done.Wait()) {}
+		}
+	}
+
+	bool LedgerFrm::ApplyTransaction(TransactionFrm::pointer tx_frm, std::shared_ptr<Environment> environment, bool parallel) {
+		if (!tx_frm->ValidForApply(environment)){
+			return false;
+		}
 
+		//contracts only run in the serial lane, they find the executing transaction on the stack
+		if (!parallel) {
 			LedgerManager::Instance().transaction_stack_.push(tx_frm);
-			tx_frm->NonceIncrease(this, environment_);
-			if (!tx_frm->Apply(this, environment_)){
-				LOG_ERROR("transaction(%s) apply failed. %s",
-					utils::String::BinToHexString(tx_frm->GetContentHash()).c_str(), tx_frm->GetResult().desc().c_str());
+		}
+		tx_frm->NonceIncrease(this, environment);
+		if (!tx_frm->Apply(this, environment)){
+			LOG_ERROR("transaction(%s) apply failed. %s",
+				utils::String::BinToHexString(tx_frm->GetContentHash()).c_str(), tx_frm->GetResult().desc().c_str());
+		}
+		else{
+			tx_frm->environment_->Commit();
+		}
+		if (!parallel) {
+			LedgerManager::Instance().transaction_stack_.pop();
+		}
+		return true;
+	}
+
+	void LedgerFrm::ApplyBatch(const protocol::ConsensusValue& request, const std::vector<int32_t> &batch,
+		const std::vector<std::set<std::string>> &batch_accounts, std::vector<TransactionFrm::pointer> &tx_frms, std::vector<bool> &applied) {
+		if (batch.empty()) {
+			return;
+		}
+
+		//union the transactions sharing an account, a group is identified by its first transaction
+		std::vector<size_t> groups(batch.size());
+		auto find_group = [&groups](size_t i) {
+			while (groups[i] != i) {
+				groups[i] = groups[groups[i]];
+				i = groups[i];
 			}
-			else{
-				tx_frm->environment_->Commit();
+			return i;
+		};
+
+		std::map<std::string, size_t> owners;
+		for (size_t i = 0; i < batch.size(); i++) {
+			groups[i] = i;
+			for (auto it = batch_accounts[i].begin(); it != batch_accounts[i].end(); it++) {
+				auto owner = owners.find(*it);
+				if (owner == owners.end()) {
+					owners[*it] = i;
+					continue;
+				}
+
+				size_t a = find_group(owner->second);
+				size_t b = find_group(i);
+				if (a < b) {
+					groups[b] = a;
+				}
+				else if (b < a) {
+					groups[a] = b;
+				}
+			}
+		}
+
+		utils::Semaphore done;
+		std::map<size_t, std::shared_ptr<ApplyGroupTask>> tasks;
+		for (size_t i = 0; i < batch.size(); i++) {
+			std::shared_ptr<ApplyGroupTask> &task = tasks[find_group(i)];
+			if (!task) {
+				task = std::make_shared<ApplyGroupTask>();
+				task->ledger_ = this;
+				task->tx_frms_ = &tx_frms;
+				task->done_ = &done;
+			}
+			task->indexes_.push_back(batch[i]);
+		}
+
+		if (tasks.size() == 1) {
+			for (size_t i = 0; i < batch.size(); i++) {
+				applied[batch[i]] = ApplyTransaction(tx_frms[batch[i]], environment_, false);
+			}
+			return;
+		}
+
+		for (auto it = tasks.begin(); it != tasks.end(); it++) {
+			it->second->environment_ = std::make_shared<Environment>(environment_.get());
+			LedgerManager::Instance().apply_pool_.AddTask(it->second.get());
+		}
+
+		for (size_t i = 0; i < tasks.size(); i++) {
+			while (!done.Wait()) {}
+		}
+
+		//the groups touch different accounts, merge them in the order of their first transaction
+		for (auto it = tasks.begin(); it != tasks.end(); it++) {
+			std::shared_ptr<ApplyGroupTask> task = it->second;
+			task->environment_->Commit();
+			for (size_t i = 0; i < task->indexes_.size(); i++) {
+				applied[task->indexes_[i]] = task->applied_[i];
 			}
-			apply_tx_frms_.push_back(tx_frm);
-			ledger_.add_transaction_envs()->CopyFrom(txproto);
-			LedgerManager::Instance().transaction_stack_.pop();
 		}
+	}
+
+	bool LedgerFrm::GetConflictAccounts(const protocol::Transaction &tran, std::set<std::string> &accounts) {
+		//an expression may read any account
+		if (tran.expr_condition().size() > 0) {
+			return false;
+		}
+
+		utils::StringVector signed_accounts;
+		accounts.insert(tran.source_address());
+		signed_accounts.push_back(tran.source_address());
+		for (int32_t i = 0; i < tran.operations_size(); i++) {
+			const protocol::Operation &ope = tran.operations(i);
+			if (ope.expr_condition().size() > 0) {
+				return false;
+			}
+
+			std::string source_address = !ope.source_address().empty() ? ope.source_address() : tran.source_address();
+			accounts.insert(source_address);
+			signed_accounts.push_back(source_address);
+
+			std::string dest_address;
+			switch (ope.type()) {
+			case protocol::Operation_Type_CREATE_ACCOUNT:
+			{
+				//contracts run in v8, which is not shared between threads
+				const protocol::OperationCreateAccount &create_account = ope.create_account();
+				if (!create_account.contract().payload().empty()) {
+					return false;
+				}
+
+				accounts.insert(create_account.dest_address());
+				for (int32_t j = 0; j < create_account.priv().signers_size(); j++) {
+					signed_accounts.push_back(create_account.priv().signers(j).address());
+				}
+				break;
+			}
+			case protocol::Operation_Type_PAYMENT:
+				dest_address = ope.payment().dest_address();
+				break;
+			case protocol::Operation_Type_PAY_COIN:
+				dest_address = ope.pay_coin().dest_address();
+				break;
+			case protocol::Operation_Type_ISSUE_ASSET:
+			case protocol::Operation_Type_SET_METADATA:
+				break;
+			default:
+				//signer and threshold changes alter what other transactions read while checking signatures
+				return false;
+			}
 
+			if (!dest_address.empty()) {
+				AccountFrm::pointer dest_account = nullptr;
+				if (environment_->PeekEntry(dest_address, dest_account) &&
+					!dest_account->GetProtoAccount().contract().payload().empty()) {
+					return false;
+				}
+				accounts.insert(dest_address);
+			}
+		}
+
+		for (size_t i = 0; i < signed_accounts.size(); i++) {
+			AddSignerAccounts(signed_accounts[i], accounts);
+		}
 		return true;
 	}
 
+	void LedgerFrm::AddSignerAccounts(const std::string &address, std::set<std::string> &accounts) {
+		//follow the signers as deep as TransactionFrm::SignerHashPriv does
+		std::set<std::string> visited;
+		visited.insert(address);
+		utils::StringVector level(1, address);
+		for (int32_t depth = 0; depth < 5 && !level.empty(); depth++) {
+			utils::StringVector next;
+			for (size_t i = 0; i < level.size(); i++) {
+				accounts.insert(level[i]);
+				AccountFrm::pointer account = nullptr;
+				if (depth == 4 || !environment_->PeekEntry(level[i], account)) {
+					continue;
+				}
+
+				const protocol::AccountPrivilege &priv = account->GetProtoAccount().priv();
+				for (int32_t j = 0; j < priv.signers_size(); j++) {
+					if (visited.insert(priv.signers(j).address()).second) {
+						next.push_back(priv.signers(j).address());
+					}
+				}
+			}
+			level.swap(next);
+		}
+	}
+
 	bool LedgerFrm::CheckValidation() {
 		return true;
 	}
@@ -30,6 +30,9 @@ namespace bubi {
 
         bool AddToDb(WRITE_BATCH& batch);
 
+		//fill the batch with the ledger and its transactions without writing it
+		void FillDbBatch(WRITE_BATCH& batch);
+
 		bool LoadFromDb(int64_t seq);
 
 		//static bool LoadFromDb(int64_t seq, protocol::Ledger &ledger);
@@ -53,7 +56,20 @@ namespace bubi {
 		bool Commit(KVTrie* trie, int64_t& new_count, int64_t& change_count);
 
 		std::string &GetConsensusValueString();
+
+		//apply a transaction on the environment, return false if it is dropped
+		bool ApplyTransaction(TransactionFrm::pointer tx_frm, std::shared_ptr<Environment> environment, bool parallel);
 	private:
+		//load the trie paths of the accounts referenced by the txset before applying it
+		void PrefetchAccounts(const protocol::ConsensusValue& request);
+		//build the transactions of the txset, on the apply threads if there are some
+		void CreateTransactions(const protocol::ConsensusValue& request, std::vector<TransactionFrm::pointer> &tx_frms);
+		//collect the accounts a transaction reads or writes, return false if it must be applied serially
+		bool GetConflictAccounts(const protocol::Transaction &tran, std::set<std::string> &accounts);
+		void AddSignerAccounts(const std::string &address, std::set<std::string> &accounts);
+		void ApplyBatch(const protocol::ConsensusValue& request, const std::vector<int32_t> &batch,
+			const std::vector<std::set<std::string>> &batch_accounts, std::vector<TransactionFrm::pointer> &tx_frms, std::vector<bool> &applied);
+
 		protocol::Ledger ledger_;
 	public:
 		std::shared_ptr<protocol::ConsensusValue> value_;
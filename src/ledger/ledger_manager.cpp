@@ -7,7 +7,7 @@
 #include "contract_manager.h"
 
 namespace bubi {
-	LedgerManager::LedgerManager() : tree_(NULL){
+	LedgerManager::LedgerManager() : tree_(NULL), tree_cache_(NULL), account_trie_cache_(NULL), signature_cache_(NULL), apply_thread_count_(1), persist_queue_size_(0), durable_seq_(0), persist_pending_(0), replaying_(false){
 		check_interval_ = 500 * utils::MICRO_UNITS_PER_MILLI;
 		timer_name_ = "Ledger Mananger";
 	}
@@ -17,6 +17,21 @@ namespace bubi {
 			delete tree_;
 			tree_ = NULL;
 		}
+
+		if (tree_cache_) {
+			delete tree_cache_;
+			tree_cache_ = NULL;
+		}
+
+		if (account_trie_cache_) {
+			delete account_trie_cache_;
+			account_trie_cache_ = NULL;
+		}
+
+		if (signature_cache_) {
+			delete signature_cache_;
+			signature_cache_ = NULL;
+		}
 	}
 
 	bool LedgerManager::GetValidators(int64_t seq, protocol::ValidatorSet& validators_set){
@@ -39,6 +54,16 @@ namespace bubi {
 		HashWrapper::SetLedgerHashType(Configure::Instance().ledger_configure_.hash_type_);
 
 		tree_ = new KVTrie();
+		uint32_t cache_size = Configure::Instance().ledger_configure_.trie_cache_size_;
+		if (cache_size > 0) {
+			tree_cache_ = new TrieNodeCache((size_t)cache_size * utils::BYTES_PER_MEGA);
+			tree_->SetCache(tree_cache_);
+		}
+		account_trie_cache_ = new KVTrieCache(Configure::Instance().ledger_configure_.account_trie_cache_count_);
+		uint32_t signature_cache_count = Configure::Instance().ledger_configure_.signature_cache_count_;
+		if (signature_cache_count > 0) {
+			signature_cache_ = new SignatureCache(signature_cache_count);
+		}
 		auto batch = std::make_shared<WRITE_BATCH>();
 		tree_->Init(Storage::Instance().account_db(), batch, General::ACCOUNT_PREFIX, 4);
 
@@ -48,7 +73,8 @@ namespace bubi {
 		if (kvdb->Get(General::KEY_LEDGER_SEQ, str_max_seq)) {
 			seq_kvdb = utils::String::Stoi64(str_max_seq);
 			int64_t seq_rational = GetMaxLedger();
-			if (seq_kvdb != seq_rational){
+			//an atomic commit writes both seqs together
+			if (!Storage::Instance().IsAtomicCommit() && seq_kvdb != seq_rational){
 				LOG_ERROR("fatal error:ledger_seq from kvdb(" FMT_I64 ") != ledger_seq from rational db(" FMT_I64 ")",
 					seq_kvdb, seq_rational);
 			}
@@ -102,6 +128,27 @@ namespace bubi {
 			BUBI_EXIT("consensus ledger version:%d,software ledger version:%d", lclheader.version(), General::LEDGER_VERSION);
 		}
 
+		apply_thread_count_ = Configure::Instance().ledger_configure_.apply_thread_count_;
+		if (apply_thread_count_ == 0) {
+			apply_thread_count_ = utils::System::GetCpuCoreCount();
+		}
+		if (apply_thread_count_ > 1) {
+			if (!apply_pool_.Init("apply", apply_thread_count_)) {
+				LOG_ERROR("Start apply thread pool failed");
+				return false;
+			}
+
+			//the pool is idle while the ledger is hashed
+			tree_->SetThreadPool(&apply_pool_);
+		}
+
+		durable_seq_ = lclheader.seq();
+		persist_queue_size_ = Configure::Instance().ledger_configure_.persist_queue_size_;
+		if (persist_queue_size_ > 0 && !persist_pool_.Init("persist", 1)) {
+			LOG_ERROR("Start persist thread failed");
+			return false;
+		}
+
 		ExprCondition::RegisterFunctions();
 		TimerNotify::RegisterModule(this);
 		StatusModule::RegisterModule(this);
@@ -110,11 +157,30 @@ namespace bubi {
 
 	bool LedgerManager::Exit() {
 		LOG_INFO("Ledger manager stoping...");
+		//flush the closed ledgers not yet written
+		WaitPersisted(0);
+		persist_pool_.Exit();
+		apply_pool_.Exit();
 
 		if (tree_) {
 			delete tree_;
 			tree_ = NULL;
 		}
+
+		if (tree_cache_) {
+			delete tree_cache_;
+			tree_cache_ = NULL;
+		}
+
+		if (account_trie_cache_) {
+			delete account_trie_cache_;
+			account_trie_cache_ = NULL;
+		}
+
+		if (signature_cache_) {
+			delete signature_cache_;
+			signature_cache_ = NULL;
+		}
 		LOG_INFO("Ledger manager stop [OK]");
 		return true;
 	}
@@ -403,6 +469,138 @@ namespace bubi {
 		} while (false);
 	}
 
+	bool LedgerManager::Replay(const std::string &source_path, int64_t end_seq) {
+		//replay writes the dbs of this node, the source must be none of them
+		const DbConfigure &db_config = Configure::Instance().db_configure_;
+		if (source_path == db_config.ledger_db_path_ ||
+			source_path == db_config.account_db_path_ ||
+			source_path == db_config.keyvalue_db_path_ ||
+			(!db_config.column_family_db_path_.empty() && source_path == db_config.column_family_db_path_)) {
+			LOG_ERROR("Replay source(%s) is a db of this node, use a copy of the ledger db", source_path.c_str());
+			return false;
+		}
+
+#ifdef WIN32
+		std::unique_ptr<LevelDbDriver> source_db(new LevelDbDriver());
+#else
+		std::unique_ptr<RocksDbDriver> source_db(new RocksDbDriver());
+#endif
+		bool ret = false;
+		do {
+			if (!source_db->Open(source_path)) {
+				LOG_ERROR("Open replay source(%s) failed, error(%s)", source_path.c_str(), source_db->error_desc().c_str());
+				break;
+			}
+
+			std::string str_max_seq;
+			if (source_db->Get(General::KEY_LEDGER_SEQ, str_max_seq) <= 0) {
+				LOG_ERROR("Load max ledger seq from replay source failed");
+				break;
+			}
+			int64_t max_seq = utils::String::Stoi64(str_max_seq);
+			if (end_seq <= 0 || end_seq > max_seq) {
+				end_seq = max_seq;
+			}
+
+			//the local state is the genesis or a snapshot, it must be a ledger of the source
+			protocol::LedgerHeader lcl_header = last_closed_ledger_->GetProtoHeader();
+			std::string str_header;
+			protocol::LedgerHeader source_header;
+			if (source_db->Get(ComposePrefix(General::LEDGER_PREFIX, lcl_header.seq()), str_header) <= 0 ||
+				!source_header.ParseFromString(str_header) ||
+				source_header.account_tree_hash() != lcl_header.account_tree_hash()) {
+				LOG_ERROR("Local ledger(" FMT_I64 ") is not in the replay source, the genesis account or the snapshot differs", lcl_header.seq());
+				break;
+			}
+
+			printf("Replay ledger " FMT_I64 " to " FMT_I64 " from %s\n", lcl_header.seq() + 1, end_seq, source_path.c_str());
+			replaying_ = true;
+			ret = true;
+			CloseTime total = { 0, 0, 0 };
+			int64_t tx_count = 0;
+			int64_t replayed = 0;
+			int64_t time_start = utils::Timestamp::HighResolution();
+
+			//the value after a ledger carries its proof, read it with the batch
+			const int64_t batch_count = 100;
+			for (int64_t begin = lcl_header.seq() + 1; ret && begin <= end_seq; begin += batch_count) {
+				int64_t end = MIN(end_seq, begin + batch_count - 1);
+				std::vector<std::string> keys;
+				for (int64_t seq = begin; seq <= end + 1; seq++) {
+					keys.push_back(ComposePrefix(General::CONSENSUS_VALUE_PREFIX, seq));
+				}
+				for (int64_t seq = begin; seq <= end; seq++) {
+					keys.push_back(ComposePrefix(General::LEDGER_PREFIX, seq));
+				}
+
+				std::vector<std::string> str_values;
+				std::vector<int32_t> results;
+				if (!source_db->MultiGet(keys, str_values, results)) {
+					LOG_ERROR("Load consensus values from replay source failed(%s)", source_db->error_desc().c_str());
+					ret = false;
+					break;
+				}
+
+				size_t value_count = (size_t)(end - begin + 2);
+				for (int64_t seq = begin; seq <= end; seq++) {
+					size_t i = (size_t)(seq - begin);
+					protocol::ConsensusValue consensus_value;
+					protocol::LedgerHeader header;
+					if (results[i] <= 0 || !consensus_value.ParseFromString(str_values[i]) ||
+						results[value_count + i] <= 0 || !header.ParseFromString(str_values[value_count + i])) {
+						LOG_ERROR("Load ledger(" FMT_I64 ") from replay source failed", seq);
+						ret = false;
+						break;
+					}
+
+					std::string proof;
+					protocol::ConsensusValue next_value;
+					if (results[i + 1] > 0 && next_value.ParseFromString(str_values[i + 1])) {
+						proof = next_value.previous_proof();
+					}
+
+					if (!CloseLedger(consensus_value, proof)) {
+						LOG_ERROR("Close ledger(" FMT_I64 ") failed", seq);
+						ret = false;
+						break;
+					}
+
+					const protocol::LedgerHeader &replayed_header = last_closed_ledger_->GetProtoHeader();
+					printf("ledger(" FMT_I64 ") txcount(" FMT_SIZE ") apply=" FMT_I64 " calc_hash=" FMT_I64 " addtodb=" FMT_I64 "\n",
+						seq, last_closed_ledger_->GetTxCount(), close_time_.apply_, close_time_.calc_hash_, close_time_.addtodb_);
+					if (replayed_header.account_tree_hash() != header.account_tree_hash() || replayed_header.hash() != header.hash()) {
+						LOG_ERROR("Replayed ledger(" FMT_I64 ") diverges, account_tree_hash(%s) hash(%s), expected account_tree_hash(%s) hash(%s)",
+							seq,
+							utils::String::BinToHexString(replayed_header.account_tree_hash()).c_str(),
+							utils::String::BinToHexString(replayed_header.hash()).c_str(),
+							utils::String::BinToHexString(header.account_tree_hash()).c_str(),
+							utils::String::BinToHexString(header.hash()).c_str());
+						ret = false;
+						break;
+					}
+
+					total.apply_ += close_time_.apply_;
+					total.calc_hash_ += close_time_.calc_hash_;
+					total.addtodb_ += close_time_.addtodb_;
+					tx_count += last_closed_ledger_->GetTxCount();
+					replayed++;
+				}
+			}
+
+			//the replayed ledgers are durable before the summary
+			WaitPersisted(0);
+			replaying_ = false;
+
+			int64_t elapsed = utils::Timestamp::HighResolution() - time_start;
+			printf("Replayed " FMT_I64 " ledgers " FMT_I64 " transactions in " FMT_I64 "us, apply=" FMT_I64 " calc_hash=" FMT_I64 " addtodb=" FMT_I64 " tx/s=%.0f, %s\n",
+				replayed, tx_count, elapsed, total.apply_, total.calc_hash_, total.addtodb_,
+				elapsed > 0 ? tx_count * 1e6 / elapsed : 0.0,
+				ret ? "all hashes match" : "stopped at the first failure");
+		} while (false);
+
+		source_db->Close();
+		return ret;
+	}
 
 	bool LedgerManager::ConsensusValueFromDB(int64_t seq, protocol::ConsensusValue& consensus_value){
 		KeyValueDb *ledger_db = Storage::Instance().ledger_db();
@@ -414,6 +612,34 @@ namespace bubi {
 		return consensus_value.ParseFromString(str_cons);
 	}
 
+	bool LedgerManager::ConsensusValuesFromDB(int64_t begin, int64_t end, std::vector<protocol::ConsensusValue>& values) {
+		values.clear();
+		if (end < begin) {
+			return true;
+		}
+
+		std::vector<std::string> keys;
+		for (int64_t seq = begin; seq <= end; seq++) {
+			keys.push_back(ComposePrefix(General::CONSENSUS_VALUE_PREFIX, seq));
+		}
+
+		std::vector<std::string> str_values;
+		std::vector<int32_t> results;
+		KeyValueDb *ledger_db = Storage::Instance().ledger_db();
+		if (!ledger_db->MultiGet(keys, str_values, results)) {
+			LOG_ERROR("Load consensus value failed(%s)", ledger_db->error_desc().c_str());
+		}
+
+		values.resize(keys.size());
+		for (size_t i = 0; i < keys.size(); i++) {
+			if (results[i] <= 0 || !values[i].ParseFromString(str_values[i])) {
+				values.resize(i);
+				return false;
+			}
+		}
+		return true;
+	}
+
 	int LedgerManager::OnConsent(const protocol::ConsensusValue &consensus_value, const std::string& proof) {
 		LOG_INFO("OnConsent Ledger consensus_value seq(" FMT_I64 ")", consensus_value.ledger_seq());
 
@@ -453,14 +679,47 @@ namespace bubi {
 		data["tx_count"] = GetLastClosedLedger().tx_count();
 		data["account_count"] = GetAccountNum();
 		data["ledger_sequence"] = GetLastClosedLedger().seq();
+		data["durable_sequence"] = GetDurableSeq();
+		data["persist_queue"] = GetPersistPending();
 		data["time"] = utils::String::Format(FMT_I64 " ms",
 			(utils::Timestamp::HighResolution() - begin_time) / utils::MICRO_UNITS_PER_MILLI);
 		data["hash_type"] = HashWrapper::GetLedgerHashType() == HashWrapper::HASH_TYPE_SM3 ? "sm3" : "sha256";
 		data["sync"] = sync_.ToJson();
+		if (tree_cache_) {
+			tree_cache_->GetModuleStatus(data["trie_cache"]);
+		}
+		if (account_trie_cache_) {
+			account_trie_cache_->GetModuleStatus(data["account_trie_cache"]);
+		}
+		if (signature_cache_) {
+			signature_cache_->GetModuleStatus(data["signature_cache"]);
+		}
 	}
 
+	//writes one closed ledger behind the apply of the next ones, the single persist thread keeps the close order
+	class PersistLedgerTask : public utils::Runnable {
+	public:
+		LedgerFrm::pointer ledger_;
+		bool notify_; //taken from replaying_ by CloseLedger, the persist thread never reads the flag
+
+		virtual void Run(utils::Thread *this_thread) override {
+			LedgerManager::Instance().PersistLedger(ledger_);
+
+			//the notices go out once the ledger is durable
+			if (!notify_) {
+				delete this;
+				return;
+			}
+			LedgerFrm::pointer ledger = ledger_;
+			Global::Instance().GetIoService().post([ledger]() {
+				LedgerManager::Instance().NotifyLedgerClosed(ledger);
+			});
+			delete this;
+		}
+	};
+
 	bool LedgerManager::CloseLedger(const protocol::ConsensusValue& consensus_value, const std::string& proof) {
-		if (!GlueManager::Instance().CheckValueAndProof(consensus_value.SerializeAsString(), proof)){
+		if (!replaying_ && !GlueManager::Instance().CheckValueAndProof(consensus_value.SerializeAsString(), proof)){
 
 			protocol::PbftProof proof_proto;
 			proof_proto.ParseFromString(proof);
@@ -485,20 +744,31 @@ namespace bubi {
 		//LOG_INFO("set_consensus_value_hash:%s,%s", utils::String::BinToHexString(con_str).c_str(), utils::String::BinToHexString(chash).c_str());
 		header->set_version(last_closed_ledger_->GetProtoHeader().version());
 
+		//backpressure, apply runs at most persist_queue_size_ ledgers ahead of the db
+		if (persist_queue_size_ > 0) {
+			WaitPersisted(persist_queue_size_ - 1);
+		}
+
 		int64_t time0 = utils::Timestamp().HighResolution();
 		tree_->time_ = 0;
+		int64_t cache_hit = tree_cache_ ? tree_cache_->hit_count() : 0;
+		int64_t cache_miss = tree_cache_ ? tree_cache_->miss_count() : 0;
 	
 		closing_ledger_->Apply(consensus_value);
 		int64_t new_count = 0, change_count = 0;
-		closing_ledger_->Commit(tree_, new_count, change_count);
-		statistics_["account_count"] = statistics_["account_count"].asInt64() + new_count;
-
-		int64_t time1 = utils::Timestamp().HighResolution();
+		int64_t time1 = 0, time2 = 0;
+		do {
+			//the api and query threads walk the same trie, it must not change under them
+			utils::MutexGuard guard(tree_mutex_);
+			closing_ledger_->Commit(tree_, new_count, change_count);
+			time1 = utils::Timestamp().HighResolution();
 
-		tree_->UpdateHash();
-		int64_t time2 = utils::Timestamp().HighResolution();
+			tree_->UpdateHash();
+			time2 = utils::Timestamp().HighResolution();
 
-		header->set_account_tree_hash(tree_->GetRootHash());
+			header->set_account_tree_hash(tree_->GetRootHash());
+		} while (false);
+		statistics_["account_count"] = statistics_["account_count"].asInt64() + new_count;
 		header->set_tx_count(last_closed_ledger_->GetProtoHeader().tx_count() + closing_ledger_->ProtoLedger().transaction_envs_size());
 
 		protocol::ValidatorSet new_set;
@@ -540,16 +810,20 @@ namespace bubi {
 		proof_ = proof;
 
 		//consensus value
-		WRITE_BATCH ledger_db_batch;
-		ledger_db_batch.Put(ComposePrefix(General::CONSENSUS_VALUE_PREFIX, consensus_value.ledger_seq()), consensus_value.SerializeAsString());
-
-		if (!closing_ledger_->AddToDb(ledger_db_batch)) {
-			BUBI_EXIT("AddToDb failed");
-		}
-
-		if (!Storage::Instance().account_db()->WriteBatch(*account_db_batch)) {
-			BUBI_EXIT("Write batch failed: %s", Storage::Instance().account_db()->error_desc().c_str());
+		std::shared_ptr<WRITE_BATCH> ledger_db_batch = std::make_shared<WRITE_BATCH>();
+		ledger_db_batch->Put(ComposePrefix(General::CONSENSUS_VALUE_PREFIX, consensus_value.ledger_seq()), consensus_value.SerializeAsString());
+
+		//the staged batches are read back at once, persist_pool_ writes them in close order
+		closing_ledger_->FillDbBatch(*ledger_db_batch);
+		Storage::Instance().ledger_db()->Stage(ledger_db_batch);
+		Storage::Instance().account_db()->Stage(account_db_batch);
+		if (account_trie_cache_) {
+			account_trie_cache_->Unpin();
 		}
+		do {
+			utils::MutexGuard guard(durable_mutex_);
+			persist_pending_++;
+		} while (false);
 
 		last_closed_ledger_ = closing_ledger_;
 		
@@ -561,18 +835,23 @@ namespace bubi {
 			tmp_lcl_header = lcl_header_ = last_closed_ledger_->GetProtoHeader();
 		} while (false);
 		
-		Global::Instance().GetIoService().post([new_set, proof, consensus_value, has_upgrade]() { //avoid deadlock
-			GlueManager::Instance().UpdateValidators(new_set, proof);
-			if (has_upgrade) GlueManager::Instance().LedgerHasUpgrade();
-		});
+		if (!replaying_) {
+			Global::Instance().GetIoService().post([new_set, proof, consensus_value, has_upgrade]() { //avoid deadlock
+				GlueManager::Instance().UpdateValidators(new_set, proof);
+				if (has_upgrade) GlueManager::Instance().LedgerHasUpgrade();
+			});
+		}
 
 		////////////////////////////
 
 		int64_t time3 = utils::Timestamp().HighResolution();
-		tree_->batch_ = std::make_shared<WRITE_BATCH>();
-		tree_->FreeMemory(4);
+		do {
+			utils::MutexGuard guard(tree_mutex_);
+			tree_->batch_ = std::make_shared<WRITE_BATCH>();
+			tree_->FreeMemory(4);
+		} while (false);
 		LOG_INFO("ledger(" FMT_I64 ") closed txcount(" FMT_SIZE ") hash(%s) apply="  FMT_I64_EX(-8) " calc_hash="  FMT_I64_EX(-8) " addtodb=" FMT_I64_EX(-8)
-			" total=" FMT_I64_EX(-8) " LoadValue=" FMT_I64 " tsize=" FMT_SIZE,
+			" total=" FMT_I64_EX(-8) " LoadValue=" FMT_I64 " cache_hit=" FMT_I64 " cache_miss=" FMT_I64 " tsize=" FMT_SIZE,
 			closing_ledger_->GetProtoHeader().seq(),
 			closing_ledger_->GetTxOpeCount(),
 			utils::String::Bin4ToHexString(closing_ledger_->GetProtoHeader().hash()).c_str(),
@@ -581,34 +860,82 @@ namespace bubi {
 			time3 - time2,
 			time3 - time0,
 			tree_->time_,
+			tree_cache_ ? tree_cache_->hit_count() - cache_hit : 0,
+			tree_cache_ ? tree_cache_->miss_count() - cache_miss : 0,
 			closing_ledger_->GetTxCount());
+		close_time_.apply_ = time1 - time0;
+		close_time_.calc_hash_ = time2 - time1;
+		close_time_.addtodb_ = time3 - time2;
+
+		if (persist_queue_size_ > 0) {
+			PersistLedgerTask *task = new PersistLedgerTask();
+			task->ledger_ = closing_ledger_;
+			task->notify_ = !replaying_;
+			persist_pool_.AddTask(task);
+		}
+		else {
+			PersistLedger(closing_ledger_);
+			if (!replaying_) NotifyLedgerClosed(closing_ledger_);
+		}
+		return true;
+	}
+
+
+	void LedgerManager::PersistLedger(LedgerFrm::pointer ledger) {
+		if (!Storage::Instance().WriteStagedLedger()) {
+			BUBI_EXIT("Write ledger(" FMT_I64 ") failed", ledger->GetProtoHeader().seq());
+		}
+
+		do {
+			utils::MutexGuard guard(durable_mutex_);
+			durable_seq_ = ledger->GetProtoHeader().seq();
+			persist_pending_--;
+		} while (false);
+		persisted_.Signal();
+	}
 
+	void LedgerManager::WaitPersisted(int64_t max_pending) {
+		//a signal left from an earlier ledger only makes the loop check again
+		while (GetPersistPending() > max_pending) {
+			persisted_.Wait();
+		}
+	}
+
+	int64_t LedgerManager::GetPersistPending() {
+		utils::MutexGuard guard(durable_mutex_);
+		return persist_pending_;
+	}
+
+	void LedgerManager::NotifyLedgerClosed(LedgerFrm::pointer ledger) {
 		//notice ledger closed
-		WebSocketServer::Instance().BroadcastMsg(protocol::CHAIN_LEDGER_HEADER, tmp_lcl_header.SerializeAsString());
+		WebSocketServer::Instance().BroadcastMsg(protocol::CHAIN_LEDGER_HEADER, ledger->GetProtoHeader().SerializeAsString());
 
 		// notice applied
-		for (size_t i = 0; i < closing_ledger_->apply_tx_frms_.size(); i++) {
-			TransactionFrm::pointer tx = closing_ledger_->apply_tx_frms_[i];
+		for (size_t i = 0; i < ledger->apply_tx_frms_.size(); i++) {
+			TransactionFrm::pointer tx = ledger->apply_tx_frms_[i];
 			WebSocketServer::Instance().BroadcastChainTxMsg(tx->GetContentHash(), tx->GetSourceAddress(),
 				tx->GetResult(), tx->GetResult().code() == protocol::ERRCODE_SUCCESS ? protocol::ChainTxStatus_TxStatus_COMPLETE : protocol::ChainTxStatus_TxStatus_FAILURE);
 		}
 		// notice dropped
-		for (size_t i = 0; i < closing_ledger_->dropped_tx_frms_.size(); i++) {
-			TransactionFrm::pointer tx = closing_ledger_->dropped_tx_frms_[i];
+		for (size_t i = 0; i < ledger->dropped_tx_frms_.size(); i++) {
+			TransactionFrm::pointer tx = ledger->dropped_tx_frms_[i];
 			WebSocketServer::Instance().BroadcastChainTxMsg(tx->GetContentHash(), tx->GetSourceAddress(),
 				tx->GetResult(), tx->GetResult().code() == protocol::ERRCODE_SUCCESS ? protocol::ChainTxStatus_TxStatus_COMPLETE : protocol::ChainTxStatus_TxStatus_FAILURE);
 		}
 
 		// monitor
 		monitor::LedgerStatus ledger_status;
-		ledger_status.mutable_ledger_header()->CopyFrom(tmp_lcl_header);
+		ledger_status.mutable_ledger_header()->CopyFrom(ledger->GetProtoHeader());
 		ledger_status.set_transaction_size(GlueManager::Instance().GetTransactionCacheSize());
 		ledger_status.set_account_count(GetAccountNum());
 		ledger_status.set_timestamp(utils::Timestamp::HighResolution());
 		MonitorManager::Instance().SendMonitor(monitor::MONITOR_MSGTYPE_LEDGER, ledger_status.SerializeAsString());
-		return true;
 	}
 
+	int64_t LedgerManager::GetDurableSeq() {
+		utils::MutexGuard guard(durable_mutex_);
+		return durable_seq_;
+	}
 
 	void LedgerManager::OnRequestLedgers(const protocol::GetLedgers &message, int64_t peer_id){
 		bool ret = true;
@@ -637,23 +964,27 @@ namespace bubi {
 
 			ledgers.set_max_seq(last_closed_ledger_->GetProtoHeader().seq());
 
-			for (int64_t i = message.begin(); i <= message.end(); i++){
-				protocol::ConsensusValue item;
-				if (!ConsensusValueFromDB(i, item)){
-					ret = false;
-					LOG_ERROR("ConsensusValueFromDB failed seq=" FMT_I64, i);
-					break;
-				}
-				ledgers.add_values()->CopyFrom(item);
+			//the next value carries the proof of the last requested one, read it in the same batch
+			int64_t seq = message.end();
+			bool is_last = seq == last_closed_ledger_->GetProtoHeader().seq();
+			std::vector<protocol::ConsensusValue> values;
+			ConsensusValuesFromDB(message.begin(), is_last ? seq : seq + 1, values);
+
+			size_t count = (size_t)(seq - message.begin() + 1);
+			if (values.size() < count){
+				ret = false;
+				LOG_ERROR("ConsensusValueFromDB failed seq=" FMT_I64, message.begin() + (int64_t)values.size());
+				break;
 			}
 
-			int64_t seq = message.end();
-			protocol::ConsensusValue next;
-			
-			if (seq == last_closed_ledger_->GetProtoHeader().seq())
+			for (size_t i = 0; i < count; i++){
+				ledgers.add_values()->CopyFrom(values[i]);
+			}
+
+			if (is_last)
 				ledgers.set_proof(proof_);
-			else if (ConsensusValueFromDB(seq + 1, next))
-				ledgers.set_proof(next.previous_proof());
+			else if (values.size() > count)
+				ledgers.set_proof(values[count].previous_proof());
 			else{
 				LOG_ERROR("");
 			}
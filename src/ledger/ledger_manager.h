@@ -31,6 +31,7 @@ namespace bubi {
 		public bubi::StatusModule {
 		friend class utils::Singleton<bubi::LedgerManager>;
 		friend class LedgerFetch;
+		friend class PersistLedgerTask;
 	public:
 
 		bool Initialize();
@@ -50,6 +51,9 @@ namespace bubi {
 
 		bool ConsensusValueFromDB(int64_t seq, protocol::ConsensusValue& request);
 
+		//read [begin, end] in one batch, values stops before the first missing seq
+		bool ConsensusValuesFromDB(int64_t begin, int64_t end, std::vector<protocol::ConsensusValue>& values);
+
 		bool DoTransaction(protocol::TransactionEnv& env);
 
 		virtual void OnTimer(int64_t current_time) override;
@@ -58,6 +62,10 @@ namespace bubi {
 
 		static void CreateHardforkLedger();
 
+		//re-execute the consensus values of source_path on top of the local state up to end_seq (0 for all),
+		//without network and consensus, and check every account_tree_hash
+		bool Replay(const std::string &source_path, int64_t end_seq);
+
 	public:
 		utils::Mutex gmutex_;
 		Json::Value statistics_;
@@ -65,6 +73,14 @@ namespace bubi {
 		//std::shared_ptr<TransactionFrm> execute_transaction_;
 		std::stack<std::shared_ptr<TransactionFrm>> transaction_stack_;
 		KVTrie* tree_;
+		TrieNodeCache* tree_cache_;
+		KVTrieCache* account_trie_cache_;
+		SignatureCache* signature_cache_; //NULL: every TransactionFrm verifies its signatures
+		utils::Mutex tree_mutex_; //held by the readers of tree_ and by CloseLedger while it changes the trie
+		utils::ThreadPool apply_pool_;
+		uint32_t apply_thread_count_;
+		utils::ThreadPool persist_pool_;
+		uint32_t persist_queue_size_;
 	private:
 		LedgerManager();
 		~LedgerManager();
@@ -75,6 +91,14 @@ namespace bubi {
 
 		bool CloseLedger(const protocol::ConsensusValue& request, const std::string& proof);
 
+		//write the staged batches of a closed ledger, on persist_pool_ unless persist_queue_size_ is 0
+		void PersistLedger(LedgerFrm::pointer ledger);
+		//block until at most max_pending closed ledgers wait for PersistLedger
+		void WaitPersisted(int64_t max_pending);
+		int64_t GetPersistPending();
+		void NotifyLedgerClosed(LedgerFrm::pointer ledger);
+		int64_t GetDurableSeq();
+
 		bool CreateGenesisAccount();
 
 		static void ValidatorsSet(std::shared_ptr<WRITE_BATCH> batch, const protocol::ValidatorSet& validators);
@@ -87,6 +111,19 @@ namespace bubi {
 		utils::ReadWriteLock lcl_header_mutex_;
 		protocol::LedgerHeader lcl_header_;
 
+		utils::Mutex durable_mutex_;
+		int64_t durable_seq_; //the last ledger written to the db
+		int64_t persist_pending_; //ledgers staged by CloseLedger and not yet written
+		utils::Semaphore persisted_; //signalled by PersistLedger after each write
+
+		bool replaying_; //skip the proof check and the notices, nobody listens. Only the main thread touches it
+		struct CloseTime {
+			int64_t apply_;
+			int64_t calc_hash_;
+			int64_t addtodb_;
+		};
+		CloseTime close_time_; //phases of the last CloseLedger
+
 		struct SyncStat{
 			int64_t send_time_;
 			protocol::GetLedgers gl_;
@@ -29,7 +29,7 @@ namespace bubi {
 	}
 
 
-	TransactionFrm::TransactionFrm(const protocol::TransactionEnv &env) :
+	TransactionFrm::TransactionFrm(const protocol::TransactionEnv &env, bool verify_signature) :
 		apply_time_(0),
 		ledger_seq_(0),
 		result_(),
@@ -38,7 +38,7 @@ namespace bubi {
 		ledger_(),
 		processing_operation_(0),
 		incoming_time_(utils::Timestamp::HighResolution()){
-		Initialize();
+		Initialize(verify_signature);
 		utils::AtomicInc(&bubi::General::tx_new_count);
 		trans_value = NULL;
 	}
@@ -59,12 +59,20 @@ namespace bubi {
 		result["hash"] = utils::String::BinToHexString(hash_);
 	}
 
-	void TransactionFrm::Initialize() {
+	void TransactionFrm::Initialize(bool verify_signature) {
 		const protocol::Transaction &tran = transaction_env_.transaction();
 		data_ = tran.SerializeAsString();
 		hash_ = HashWrapper::Crypto(data_);
 		full_data_ = transaction_env_.SerializeAsString();
 		full_hash_ = HashWrapper::Crypto(full_data_);
+		if (!verify_signature) {
+			return;
+		}
+
+		SignatureCache *cache = LedgerManager::Instance().signature_cache_;
+		if (cache && cache->Get(full_hash_, true, valid_signature_)) {
+			return;
+		}
 
 		for (int32_t i = 0; i < transaction_env_.signatures_size(); i++) {
 			const protocol::Signature &signature = transaction_env_.signatures(i);
@@ -80,6 +88,163 @@ namespace bubi {
 			}
 			valid_signature_.insert(pubkey.GetBase16Address());
 		}
+
+		if (cache) {
+			cache->Put(full_hash_, true, valid_signature_);
+		}
+	}
+
+	//checks a slice of the signatures of VerifySignatures
+	class VerifyBatchTask : public utils::Runnable {
+	public:
+		std::vector<PublicKey::VerifyItem> items_;
+		std::vector<bool> valids_;
+		bool exact_;
+		utils::Semaphore *done_;
+
+		void Verify() {
+			if (!exact_) {
+				PublicKey::VerifyBatch(items_, valids_);
+				return;
+			}
+
+			valids_.resize(items_.size());
+			for (size_t i = 0; i < items_.size(); i++) {
+				valids_[i] = PublicKey::Verify(*items_[i].data_, *items_[i].signature_, *items_[i].public_key_);
+			}
+		}
+
+		virtual void Run(utils::Thread *this_thread) override {
+			Verify();
+			done_->Signal();
+		}
+	};
+
+	void TransactionFrm::VerifySignatures(const std::vector<TransactionFrm::pointer> &txs, utils::ThreadPool *pool, bool exact) {
+		SignatureCache *cache = LedgerManager::Instance().signature_cache_;
+		std::vector<PublicKey::VerifyItem> items;
+		std::vector<std::pair<TransactionFrm *, std::string>> signers;
+		std::vector<TransactionFrm *> verified_txs;
+		for (size_t i = 0; i < txs.size(); i++) {
+			TransactionFrm *tx = txs[i].get();
+			if (cache && cache->Get(tx->full_hash_, exact, tx->valid_signature_)) {
+				continue;
+			}
+
+			verified_txs.push_back(tx);
+			for (int32_t j = 0; j < tx->transaction_env_.signatures_size(); j++) {
+				const protocol::Signature &signature = tx->transaction_env_.signatures(j);
+				PublicKey pubkey(signature.public_key());
+				if (!pubkey.IsValid()) {
+					LOG_ERROR("Invalid publickey(%s)", signature.public_key().c_str());
+					continue;
+				}
+
+				PublicKey::VerifyItem item;
+				item.data_ = &tx->data_;
+				item.signature_ = &signature.sign_data();
+				item.public_key_ = &signature.public_key();
+				items.push_back(item);
+				signers.push_back(std::make_pair(tx, pubkey.GetBase16Address()));
+			}
+		}
+
+		//a batch of ed25519-donna holds 64 signatures
+		const size_t slice_size = 64;
+		std::vector<std::shared_ptr<VerifyBatchTask>> tasks;
+		utils::Semaphore done;
+		for (size_t begin = 0; begin < items.size(); begin += slice_size) {
+			std::shared_ptr<VerifyBatchTask> task = std::make_shared<VerifyBatchTask>();
+			task->items_.assign(items.begin() + begin, items.begin() + std::min(items.size(), begin + slice_size));
+			task->exact_ = exact;
+			task->done_ = &done;
+			tasks.push_back(task);
+		}
+
+		if (pool != NULL && tasks.size() > 1) {
+			for (size_t i = 0; i < tasks.size(); i++) {
+				pool->AddTask(tasks[i].get());
+			}
+			for (size_t i = 0; i < tasks.size(); i++) {
+				while (!done.Wait()) {}
+			}
+		}
+		else {
+			for (size_t i = 0; i < tasks.size(); i++) {
+				tasks[i]->Verify();
+			}
+		}
+
+		for (size_t i = 0; i < items.size(); i++) {
+			if (!tasks[i / slice_size]->valids_[i % slice_size]) {
+				LOG_ERROR("Invalid signature data(%s)", utils::String::BinToHexString(*items[i].signature_).c_str());
+				continue;
+			}
+			signers[i].first->valid_signature_.insert(signers[i].second);
+		}
+
+		for (size_t i = 0; cache && i < verified_txs.size(); i++) {
+			cache->Put(verified_txs[i]->full_hash_, exact, verified_txs[i]->valid_signature_);
+		}
+	}
+
+	SignatureCache::SignatureCache(size_t max_count) :hit_count_(0), miss_count_(0) {
+		for (size_t i = 0; i < SHARD_COUNT; i++) {
+			shards_.push_back(std::make_shared<Shard>(max_count / SHARD_COUNT + 1));
+		}
+	}
+
+	SignatureCache::~SignatureCache() {}
+
+	SignatureCache::Shard &SignatureCache::GetShard(const std::string &full_hash) {
+		//the hash is uniform, its first byte picks the shard
+		size_t index = full_hash.empty() ? 0 : (uint8_t)full_hash[0] % SHARD_COUNT;
+		return *shards_[index];
+	}
+
+	bool SignatureCache::Get(const std::string &full_hash, bool exact, std::set<std::string> &signers) {
+		Shard &shard = GetShard(full_hash);
+		EntryPointer entry;
+		do {
+			utils::MutexGuard guard(shard.mutex_);
+			if (!shard.entries_.get(full_hash, entry)) {
+				entry = NULL;
+			}
+		} while (false);
+
+		if (!entry || (exact && !entry->exact_)) {
+			utils::AtomicInc(&miss_count_);
+			return false;
+		}
+
+		utils::AtomicInc(&hit_count_);
+		signers = entry->signers_;
+		return true;
+	}
+
+	void SignatureCache::Put(const std::string &full_hash, bool exact, const std::set<std::string> &signers) {
+		std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+		entry->signers_ = signers;
+		entry->exact_ = exact;
+
+		Shard &shard = GetShard(full_hash);
+		utils::MutexGuard guard(shard.mutex_);
+		EntryPointer exist;
+		if (!exact && shard.entries_.get(full_hash, exist) && exist->exact_) {
+			return;
+		}
+		shard.entries_.put(full_hash, entry);
+	}
+
+	void SignatureCache::GetModuleStatus(Json::Value &data) {
+		size_t count = 0;
+		for (size_t i = 0; i < shards_.size(); i++) {
+			utils::MutexGuard guard(shards_[i]->mutex_);
+			count += shards_[i]->entries_.size();
+		}
+		data["count"] = (Json::UInt64)count;
+		data["hit"] = hit_count_;
+		data["miss"] = miss_count_;
 	}
 
 	std::string TransactionFrm::GetContentHash() const {
@@ -389,6 +554,10 @@ namespace bubi {
 			return protocol::ERRCODE_NOT_EXIST;
 		}
 
+		return LoadFromStore(hash, txenv_store);
+	}
+
+	uint32_t TransactionFrm::LoadFromStore(const std::string &hash, const std::string &txenv_store) {
 		protocol::TransactionEnvStore envstor;
 		if (!envstor.ParseFromString(txenv_store)) {
 			LOG_ERROR("Decode tx(%s) body failed", utils::String::BinToHexString(hash).c_str());
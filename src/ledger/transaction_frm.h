@@ -4,6 +4,7 @@
 
 #include <unordered_map>
 #include <utils/common.h>
+#include <utils/lrucache.hpp>
 #include <common/general.h>
 #include <ledger/account.h>
 #include <overlay/peer.h>
@@ -17,6 +18,38 @@ namespace bubi {
 	class OperationFrm;
 	class AccountEntry;
 	class LedgerFrm;
+
+	//signers of the valid signatures of a transaction, keyed by its full hash which covers the signatures.
+	//A result of an ed25519 batch is not exact and never serves a caller asking for an exact one
+	class SignatureCache {
+	public:
+		SignatureCache(size_t max_count);
+		~SignatureCache();
+
+		bool Get(const std::string &full_hash, bool exact, std::set<std::string> &signers);
+		void Put(const std::string &full_hash, bool exact, const std::set<std::string> &signers);
+		void GetModuleStatus(Json::Value &data);
+
+	private:
+		struct Entry {
+			std::set<std::string> signers_;
+			bool exact_;
+		};
+		typedef std::shared_ptr<const Entry> EntryPointer;
+
+		//the lock of one shard is held by a single lookup
+		static const size_t SHARD_COUNT = 16;
+		struct Shard {
+			Shard(size_t max_count) :entries_(max_count) {}
+			cache::lru_cache<std::string, EntryPointer> entries_;
+			utils::Mutex mutex_;
+		};
+		std::vector<std::shared_ptr<Shard>> shards_;
+		volatile int64_t hit_count_;
+		volatile int64_t miss_count_;
+
+		Shard &GetShard(const std::string &full_hash);
+	};
 	class TransactionFrm {
 	public:
 		typedef std::shared_ptr<bubi::TransactionFrm> pointer;
@@ -27,7 +60,8 @@ namespace bubi {
 	public:
 		//only valid when the transaction belongs to a txset
 		TransactionFrm();
-		TransactionFrm(const protocol::TransactionEnv &env);
+		//verify_signature false leaves the signatures to VerifySignatures
+		TransactionFrm(const protocol::TransactionEnv &env, bool verify_signature = true);
 		
 		virtual ~TransactionFrm();
 		
@@ -54,11 +88,25 @@ namespace bubi {
 
 		Result GetResult() const;
 
-		void Initialize();
+		void Initialize(bool verify_signature = true);
+
+		//checks the signatures of transactions built without verify_signature, spread on pool if any.
+		//Without exact they go in ed25519 batches whose result only filters transactions; a consensus decision,
+		//like the validity vote of a txset, wants exact, one signature at a time and only exact cache hits
+		static void VerifySignatures(const std::vector<TransactionFrm::pointer> &txs, utils::ThreadPool *pool, bool exact = false);
 
 		uint32_t LoadFromDb(const std::string &hash);
+		//parse a TransactionEnvStore read from the ledger db
+		uint32_t LoadFromStore(const std::string &hash, const std::string &txenv_store);
 
 		bool CheckTimeout(int64_t expire_time);
+		int64_t GetInComingTime() const {
+			return incoming_time_;
+		}
+		//before the transaction is queued, the queue indexes the expiry by it
+		void SetInComingTime(int64_t incoming_time) {
+			incoming_time_ = incoming_time;
+		}
 		void NonceIncrease(LedgerFrm* ledger_frm, std::shared_ptr<Environment> env);
 		bool Apply(LedgerFrm* ledger_frm, std::shared_ptr<Environment> env, bool bool_contract = false);
 		bool ApplyExpr(const std::string &code, const std::string &log_prefix);
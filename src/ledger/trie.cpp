@@ -1,4 +1,5 @@
 
+#include <bitset>
 #include <utils/logger.h>
 #include "utils/strings.h"
 #include "trie.h"
@@ -16,39 +17,218 @@ namespace bubi{
 	-----------------------------
 	*/
 
-	NodeFrm::NodeFrm(const Location& location)
-		:leaf_(nullptr),  /*indb_(false),leaf_indb_(false),*/ leaf_deleted_(false), modified_(true), location_(location){
-		for (int i = 0; i <= 16; i++){
-			protocol::Child* ch = info_.add_children();
-			if (i != 16)
-				children_[i] = nullptr;
+	NibblePath::NibblePath() :length_(0){
+		memset(inline_, 0, sizeof(inline_));
+	}
+
+	void NibblePath::Resize(size_t length){
+		size_t bytes = (length + 1) / 2;
+		length_ = length;
+		if (bytes > INLINE_BYTES){
+			heap_.assign(bytes, 0);
+		}
+		else{
+			heap_.clear();
+			memset(inline_, 0, bytes);
+		}
+	}
+
+	NibblePath NibblePath::FromKey(const std::string& key){
+		NibblePath path;
+		path.Resize(key.size() * 2);
+		memcpy(path.data(), key.data(), key.size());
+		return path;
+	}
+
+	NibblePath NibblePath::FromLocation(const Location& location){
+		NibblePath path;
+		if (location.size() <= 1){
+			return path;
+		}
+
+		size_t bytes = location.size() - 1;
+		bool odd = location[0] == Trie::ODD_PREFIX;
+		path.Resize(bytes * 2 - (odd ? 1 : 0));
+		uint8_t *dest = path.data();
+		memcpy(dest, location.data() + 1, bytes);
+		if (odd){
+			dest[bytes - 1] &= 0xf0;
+		}
+		return path;
+	}
+
+	Location NibblePath::ToLocation() const{
+		size_t bytes = (length_ + 1) / 2;
+		Location location;
+		location.resize(bytes + 1);
+		location[0] = (length_ % 2 == 1) ? Trie::ODD_PREFIX : Trie::EVEN_PREFIX;
+		memcpy(&location[1], data(), bytes);
+		return location;
+	}
+
+	int NibblePath::At(size_t index) const{
+		assert(index < length_);
+		uint8_t ch = data()[index / 2];
+		return (index % 2 == 0) ? (ch >> 4) : (ch & 0x0f);
+	}
+
+	NibblePath NibblePath::Prefix(size_t length) const{
+		assert(length <= length_);
+		NibblePath path;
+		path.Resize(length);
+		size_t bytes = (length + 1) / 2;
+		uint8_t *dest = path.data();
+		memcpy(dest, data(), bytes);
+		if (length % 2 == 1){
+			dest[bytes - 1] &= 0xf0;
+		}
+		return path;
+	}
+
+	size_t NibblePath::CommonPrefixLength(const NibblePath& other) const{
+		const uint8_t *s1 = data();
+		const uint8_t *s2 = other.data();
+		size_t max_length = length_ < other.length_ ? length_ : other.length_;
+		size_t bytes = max_length / 2;
+
+		//compare a word at a time, then the remaining bytes
+		size_t i = 0;
+		for (; i + sizeof(uint64_t) <= bytes; i += sizeof(uint64_t)){
+			uint64_t w1, w2;
+			memcpy(&w1, s1 + i, sizeof(w1));
+			memcpy(&w2, s2 + i, sizeof(w2));
+			if (w1 != w2){
+				break;
+			}
+		}
+		for (; i < bytes; i++){
+			if (s1[i] != s2[i]){
+				break;
+			}
 		}
+
+		size_t length = i * 2;
+		if (length < max_length && (s1[i] & 0xf0) == (s2[i] & 0xf0)){
+			length++;
+		}
+		return length;
+	}
+
+	bool NibblePath::operator==(const NibblePath& other) const{
+		return length_ == other.length_ && memcmp(data(), other.data(), (length_ + 1) / 2) == 0;
+	}
+
+	NodeChild::NodeChild() :type_(protocol::NONE){
+	}
+
+	bool NodeChild::IsEmpty() const{
+		return type_ == protocol::NONE && sublocation_.empty() && hash_.empty();
+	}
+
+	NodeFrm::NodeFrm(const NibblePath& location)
+		:leaf_(nullptr),  /*indb_(false),leaf_indb_(false),*/ leaf_deleted_(false), modified_(true), location_(location), mask_(0){
 		NEWCOUNT++;
 	}
 
+	size_t NodeFrm::EntryIndex(int branch) const{
+		return std::bitset<32>(mask_ & ((1u << branch) - 1)).count();
+	}
+
 	void NodeFrm::SetValue(const std::string& v){
 		modified_ = true;
 		leaf_deleted_ = false;
 		leaf_ = std::make_shared<std::string>(v);
-		protocol::Child* ch16 = info_.mutable_children(16);
-		ch16->set_childtype(protocol::LEAF);
-		ch16->set_sublocation(location_);
+		NodeChild* ch16 = MutableChild(LEAF_BRANCH);
+		ch16->type_ = protocol::LEAF;
+		ch16->sublocation_ = location_.ToLocation();
 	}
 
 	void NodeFrm::MarkRemove(){
 		modified_ = true;
 		leaf_deleted_ = true;
 		leaf_ = nullptr;
-		protocol::Child* ch16 = info_.mutable_children(16);
-		ch16->Clear();
+		ClearChild(LEAF_BRANCH);
 	}
 
 	void NodeFrm::SetChild(int branch, POINTER child){
 		assert(branch < 16);
 		modified_ = true;
-		children_[branch] = child;
-		info_.mutable_children(branch)->set_sublocation(child->location_);
-		//info_.mutable_children(branch)->set_childtype();
+		children_[branch].reset(child);
+		MutableChild(branch)->sublocation_ = child->location_.ToLocation();
+	}
+
+	NodeFrm::POINTER NodeFrm::ReleaseChild(int branch){
+		assert(branch < 16);
+		return children_[branch].release();
+	}
+
+	const NodeChild* NodeFrm::GetChild(int branch) const{
+		if ((mask_ & (1u << branch)) == 0){
+			return nullptr;
+		}
+		return &entries_[EntryIndex(branch)];
+	}
+
+	NodeChild* NodeFrm::MutableChild(int branch){
+		size_t index = EntryIndex(branch);
+		if ((mask_ & (1u << branch)) == 0){
+			mask_ |= (1u << branch);
+			entries_.insert(entries_.begin() + index, NodeChild());
+		}
+		return &entries_[index];
+	}
+
+	void NodeFrm::SetChildInfo(int branch, const NodeChild& child){
+		if (child.IsEmpty()){
+			ClearChild(branch);
+		}
+		else{
+			*MutableChild(branch) = child;
+		}
+	}
+
+	void NodeFrm::ClearChild(int branch){
+		if ((mask_ & (1u << branch)) != 0){
+			entries_.erase(entries_.begin() + EntryIndex(branch));
+			mask_ &= ~(1u << branch);
+		}
+	}
+
+	protocol::CHILDTYPE NodeFrm::ChildType(int branch) const{
+		const NodeChild* child = GetChild(branch);
+		return child == nullptr ? protocol::NONE : child->type_;
+	}
+
+	void NodeFrm::FromProto(const protocol::Node& info){
+		mask_ = 0;
+		entries_.clear();
+		for (int i = 0; i < info.children_size() && i <= LEAF_BRANCH; i++){
+			const protocol::Child& chd = info.children(i);
+			NodeChild child;
+			child.sublocation_ = chd.sublocation();
+			child.hash_ = chd.hash();
+			child.type_ = chd.childtype();
+			SetChildInfo(i, child);
+		}
+	}
+
+	void NodeFrm::ToProto(protocol::Node& info) const{
+		info.Clear();
+		for (int i = 0; i <= LEAF_BRANCH; i++){
+			protocol::Child* chd = info.add_children();
+			const NodeChild* child = GetChild(i);
+			if (child != nullptr){
+				chd->set_sublocation(child->sublocation_);
+				chd->set_hash(child->hash_);
+				chd->set_childtype(child->type_);
+			}
+		}
+	}
+
+	std::string NodeFrm::Serialize() const{
+		protocol::Node info;
+		ToProto(info);
+		return info.SerializeAsString();
 	}
 
 	NodeFrm::~NodeFrm(){
@@ -56,8 +236,6 @@ namespace bubi{
 	}
 
 	Trie::Trie(){
-		rootl = "";
-		rootl.push_back(0);
 	}
 
 
@@ -66,16 +244,18 @@ namespace bubi{
 	}
 
 	void Trie::FreeMemory(int depth){
-		Release(root_, depth);
+		if (root_ != nullptr){
+			Release(root_.get(), depth);
+		}
 	}
 
 	void Trie::Release(NodeFrm::POINTER node, int depth){
 		for (int i = 0; i < 16; i++){
-			auto child = node->children_[i];
+			NodeFrm::POINTER child = node->children_[i].get();
 			if (child != nullptr){
 				Release(child, depth - 1);
 				if (depth <= 0){
-					node->children_[i] = nullptr;
+					node->children_[i].reset();
 				}
 			}
 		}
@@ -83,143 +263,208 @@ namespace bubi{
 
 	NodeFrm::POINTER Trie::ChildMayFromDB(NodeFrm::POINTER node, int branch) {
 		if (node->children_[branch] == nullptr){
-			NodeFrm::POINTER frm = nullptr;
-			const protocol::Child& chd = node->info_.children(branch);
-			if (chd.childtype() == protocol::NONE){
+			const NodeChild* chd = node->GetChild(branch);
+			if (chd == nullptr || chd->type_ == protocol::NONE){
 				return nullptr;
 			}
 
-			frm = std::make_shared<NodeFrm>(chd.sublocation());
+			if (chd->type_ == protocol::INNER){
+				protocol::Node info;
+				if (!storage_load(chd->sublocation_, info)){
+					BUBI_EXIT("load:%s failed", utils::String::BinToHexString(chd->sublocation_).c_str());
+				}
+				return AttachChild(node, branch, info);
+			}
+
+			NodeFrm::POINTER frm = new NodeFrm(NibblePath::FromLocation(chd->sublocation_));
 			frm->modified_ = false;
+			if (chd->type_ == protocol::LEAF){
+				frm->SetChildInfo(NodeFrm::LEAF_BRANCH, *chd);
+			}
+			node->children_[branch].reset(frm);
+		}
+		return node->children_[branch].get();
+	}
 
-			if (chd.childtype() == protocol::LEAF){
-				frm->info_.mutable_children(16)->CopyFrom(node->info_.children(branch));
+	NodeFrm::POINTER Trie::AttachChild(NodeFrm::POINTER node, int branch, const protocol::Node& info){
+		const NodeChild* chd = node->GetChild(branch);
+		NodeFrm::POINTER frm = new NodeFrm(NibblePath::FromLocation(chd->sublocation_));
+		frm->modified_ = false;
+		frm->FromProto(info);
+		node->children_[branch].reset(frm);
+		return frm;
+	}
 
-			}
-			else if (chd.childtype() == protocol::INNER){
-				if (!storage_load(chd.sublocation(), frm->info_)){
-					BUBI_EXIT("load:%s failed", utils::String::BinToHexString(chd.sublocation()).c_str());
-				}
-			}
-			node->children_[branch] = frm;
+	void Trie::storage_multi_load(const std::vector<Location>& locations, std::vector<protocol::Node>& infos, std::vector<bool>& founds){
+		infos.resize(locations.size());
+		founds.resize(locations.size());
+		for (size_t i = 0; i < locations.size(); i++){
+			founds[i] = storage_load(locations[i], infos[i]);
 		}
-		return node->children_[branch];
 	}
 
+	void Trie::Prefetch(const std::vector<std::string>& keys){
+		if (root_ == nullptr){
+			return;
+		}
 
-	Location Trie::CommonPrefix(const Location& s1, const Location& s2){
-		Location out = "";
-		char pre = EVEN_PREFIX;
-		out.push_back(pre);
-		for (std::size_t i = 1; i < s1.length() && i < s2.length(); i++){
-			char c1 = s1.at(i);
-			char c2 = s2.at(i);
-			if ((c1 & 0xf0) != (c2 & 0xf0)){
-				break;
+		std::vector<std::pair<NodeFrm::POINTER, NibblePath>> cursors;
+		for (size_t i = 0; i < keys.size(); i++){
+			cursors.push_back(std::make_pair(root_.get(), NibblePath::FromKey(keys[i])));
+		}
+
+		while (!cursors.empty()){
+			//walk down the loaded nodes, stop at the first inner node not in memory
+			std::map<std::pair<NodeFrm::POINTER, int>, size_t> pending;
+			std::vector<std::pair<NodeFrm::POINTER, int>> slots;
+			std::vector<Location> locations;
+			std::vector<std::pair<size_t, NibblePath>> next;
+			for (size_t i = 0; i < cursors.size(); i++){
+				NodeFrm::POINTER node = cursors[i].first;
+				const NibblePath& key = cursors[i].second;
+				while (node != nullptr && node->location_ != key){
+					int branch = key.At(node->location_.CommonPrefixLength(key));
+					const NodeChild* child = node->GetChild(branch);
+					if (child == nullptr || child->type_ != protocol::INNER){
+						break;
+					}
+
+					NibblePath location2 = NibblePath::FromLocation(child->sublocation_);
+					if (location2.CommonPrefixLength(key) != location2.length()){
+						break;
+					}
+
+					if (node->children_[branch] != nullptr){
+						node = node->children_[branch].get();
+						continue;
+					}
+
+					std::pair<NodeFrm::POINTER, int> slot(node, branch);
+					auto it = pending.find(slot);
+					if (it == pending.end()){
+						it = pending.insert(std::make_pair(slot, slots.size())).first;
+						slots.push_back(slot);
+						locations.push_back(child->sublocation_);
+					}
+					next.push_back(std::make_pair(it->second, key));
+					break;
+				}
 			}
 
-			if (i == s1.length() - 1 && s1.at(0) == ODD_PREFIX){
-				char ch = c1 & 0xf0;
-				out.push_back(ch);
-				pre = ODD_PREFIX;
+			if (locations.empty()){
 				break;
 			}
 
-			if (i == s2.length() - 1 && s2.at(0) == ODD_PREFIX){
-				char ch = c1 & 0xf0;
-				out.push_back(ch);
-				pre = ODD_PREFIX;
-				break;
-			}
+			std::vector<protocol::Node> infos;
+			std::vector<bool> founds;
+			storage_multi_load(locations, infos, founds);
 
-			if ((c1 & 0x0f) != (c2 & 0x0f)){
-				char ch = c1 & 0xf0;
-				out.push_back(ch);
-				pre = ODD_PREFIX;
-				break;
+			std::vector<NodeFrm::POINTER> loaded(slots.size());
+			for (size_t i = 0; i < slots.size(); i++){
+				if (!founds[i]){
+					BUBI_EXIT("load:%s failed", utils::String::BinToHexString(locations[i]).c_str());
+				}
+				loaded[i] = AttachChild(slots[i].first, slots[i].second, infos[i]);
 			}
 
-			char ch = c1;
-			out.push_back(ch);
+			cursors.clear();
+			for (size_t i = 0; i < next.size(); i++){
+				cursors.push_back(std::make_pair(loaded[next[i].first], next[i].second));
+			}
 		}
-		out[0] = pre;
-		return out;
 	}
 
 
-	int Trie::NextBranch(const Location& s1, const Location& s2){
-		int len1 = s1.length();
-		if (s1.at(0) == ODD_PREFIX){
-			char ch = s2.at(len1 - 1);
-			return ch & 0x0f;
+	NibblePath Trie::CommonPrefix(const NibblePath& s1, const NibblePath& s2){
+		return s1.Prefix(s1.CommonPrefixLength(s2));
+	}
+
+	int Trie::NextBranch(const NibblePath& s1, const NibblePath& s2){
+		return s2.At(s1.length());
+	}
+
+	void Trie::HashCryptoMulti(const std::vector<const std::string*>& inputs, std::vector<std::string>& outputs){
+		outputs.resize(inputs.size());
+		for (size_t i = 0; i < inputs.size(); i++){
+			outputs[i] = HashCrypto(*inputs[i]);
 		}
-		else {
-			char ch = s2.at(len1);
-			return (ch >> 4) & 0x0f;
+	}
+
+	void Trie::CollectModifiedLeaves(NodeFrm::POINTER node, std::vector<NodeFrm::POINTER>& nodes){
+		if (!node->leaf_deleted_ && node->leaf_ != nullptr){
+			nodes.push_back(node);
+		}
+
+		for (int i = 0; i < 16; i++){
+			NodeFrm::POINTER child = node->children_[i].get();
+			if ((child != nullptr) && (child->modified_)){
+				CollectModifiedLeaves(child, nodes);
+			}
 		}
 	}
 
-	Location Trie::Key2Location(const std::string& key){
-		Location location = "";
-		location.push_back(EVEN_PREFIX);
-		return location + key;
+	NodeChild Trie::UpdateNodeHash(NodeFrm::POINTER node){
+		//the leaves do not depend on each other, unlike the inner nodes
+		std::vector<NodeFrm::POINTER> nodes;
+		if (node->modified_){
+			CollectModifiedLeaves(node, nodes);
+		}
+
+		std::vector<const std::string*> inputs(nodes.size());
+		for (size_t i = 0; i < nodes.size(); i++){
+			inputs[i] = nodes[i]->leaf_.get();
+		}
+		std::vector<std::string> outputs;
+		HashCryptoMulti(inputs, outputs);
+		for (size_t i = 0; i < nodes.size(); i++){
+			leaf_hashes_[nodes[i]] = outputs[i];
+		}
+
+		NodeChild result = update_hash(node);
+		leaf_hashes_.clear();
+		return result;
 	}
 
-	protocol::Child Trie::update_hash(NodeFrm::POINTER node){
+	NodeChild Trie::update_hash(NodeFrm::POINTER node){
 
 		int branch_count = 0;
 		int onlybranch = -1;
-		int64_t children_count = 0;
 
 		//////////////////////////////////////////////////////////////
 		if (!node->leaf_deleted_){
 			if (node->leaf_ != nullptr){
-				protocol::Child* this_child = node->info_.mutable_children(16);
-#ifdef COUNT
-				this_child->set_count(1);
-#endif
-				this_child->set_sublocation(node->location_);
-				this_child->set_hash(HashCrypto(*(node->leaf_)));
-				this_child->set_childtype(protocol::LEAF);
+				NodeChild* this_child = node->MutableChild(NodeFrm::LEAF_BRANCH);
+				this_child->sublocation_ = node->location_.ToLocation();
+				auto leaf_hash = leaf_hashes_.find(node);
+				this_child->hash_ = leaf_hash != leaf_hashes_.end() ? leaf_hash->second : HashCrypto(*(node->leaf_));
+				this_child->type_ = protocol::LEAF;
 				StorageSaveLeaf(node);
 			}
 		}
 		else{
-			protocol::Child* ch = node->info_.mutable_children(16);
-			ch->Clear();
+			node->ClearChild(NodeFrm::LEAF_BRANCH);
 			StorageDeleteLeaf(node);
 		}
 
-		if (node->info_.children(16).childtype() != protocol::CHILDTYPE::NONE){
+		if (node->ChildType(NodeFrm::LEAF_BRANCH) != protocol::CHILDTYPE::NONE){
 			branch_count++;
-			onlybranch = 16;
-			children_count++;
+			onlybranch = NodeFrm::LEAF_BRANCH;
 		}
 
 		for (int i = 0; i < 16; i++){
-			NodeFrm::POINTER child = node->children_[i];
+			NodeFrm::POINTER child = node->children_[i].get();
 			if ((child != nullptr) && (child->modified_)){
-				protocol::Child childresult = update_hash(child);
-				node->info_.mutable_children(i)->CopyFrom(childresult);
+				node->SetChildInfo(i, update_hash(child));
 			}
 
-			if (node->info_.children(i).childtype() != protocol::CHILDTYPE::NONE){
+			if (node->ChildType(i) != protocol::CHILDTYPE::NONE){
 				branch_count++;
 				onlybranch = i;
-#ifdef COUNT
-				if (node->info_.children(i).count() == 0){
-					printf("fatel error");
-				}
-				children_count += node->info_.children(i).count();
-#endif
 			}
 		}
 
 
-		protocol::Child result;
-#ifdef COUNT
-		result.set_count(children_count);
-#endif		
+		NodeChild result;
 		if (branch_count == 0 && node->location_ != rootl){
 			StorageDeleteNode(node);
 			//node->indb_ = false;
@@ -227,53 +472,52 @@ namespace bubi{
 		else if (branch_count == 1 && node->location_ != rootl){
 			StorageDeleteNode(node);
 			//node->indb_ = false;
-			result.CopyFrom(node->info_.children(onlybranch));
+			result = *node->GetChild(onlybranch);
 		}
 		else {
 			StorageSaveNode(node);
-			result.set_hash(HashCrypto(node->info_.SerializeAsString()));
-			result.set_sublocation(node->location_);
-			result.set_childtype(protocol::CHILDTYPE::INNER);
-#ifdef COUNT
-			result.set_count(children_count);
-#endif
+			result.hash_ = HashCrypto(node->Serialize());
+			result.sublocation_ = node->location_.ToLocation();
+			result.type_ = protocol::CHILDTYPE::INNER;
 		}
 		node->modified_ = false;
 		return result;
 	}
 
-	bool Trie::SetItem(NodeFrm::POINTER node, const Location& location, const std::string &data, int depth){
+	bool Trie::SetItem(NodeFrm::POINTER node, const NibblePath& location, const std::string &data, int depth){
 
 		node->modified_ = true;
-		Location location1 = node->location_;
+		const NibblePath& location1 = node->location_;
 
 		if (location1 == location){
 			node->SetValue(data);
 			return false;
 		}
 
-		Location common = CommonPrefix(location1, location);
-		int branch = NextBranch(common, location);
+		int branch = location.At(location1.CommonPrefixLength(location));
 
 		NodeFrm::POINTER node2 = ChildMayFromDB(node, branch);
-		protocol::Child child2 = node->info_.children(branch);
 		if (node2 == nullptr){
-			NodeFrm::POINTER newnode = std::make_shared<NodeFrm>(location);
+			NodeFrm::POINTER newnode = new NodeFrm(location);
 			newnode->SetValue(data);
 
 			node->SetChild(branch, newnode);
-			node->info_.mutable_children(branch)->set_childtype(protocol::LEAF);
+			node->MutableChild(branch)->type_ = protocol::LEAF;
 			
 			return true;
 		}
+		NodeChild child2;
+		if (node->GetChild(branch) != nullptr){
+			child2 = *node->GetChild(branch);
+		}
 
-		Location location2 = node2->location_;
-		std::string newcommon = CommonPrefix(location, location2);
-		if (newcommon == location2){
+		const NibblePath& location2 = node2->location_;
+		size_t newcommon = location.CommonPrefixLength(location2);
+		if (newcommon == location2.length()){
 			return SetItem(node2, location, data, depth + 1);
 		}
 
-		if (newcommon == location){
+		if (newcommon == location.length()){
 			/*newcommon < node2.key_*/
 			/*
 				node1
@@ -284,14 +528,14 @@ namespace bubi{
 				|
 				node2
 				*/
-			NodeFrm::POINTER newnode = std::make_shared< NodeFrm>(location);
+			NodeFrm::POINTER newnode = new NodeFrm(location);
 			newnode->SetValue(data);
-			int b1 = NextBranch(newcommon, location2);
-			newnode->SetChild(b1, node2);
-			newnode->info_.mutable_children(b1)->CopyFrom(child2);
+			int b1 = location2.At(newcommon);
+			newnode->SetChild(b1, node->ReleaseChild(branch));
+			newnode->SetChildInfo(b1, child2);
 
 			node->SetChild(branch, newnode);
-			node->info_.mutable_children(branch)->set_childtype(protocol::INNER);
+			node->MutableChild(branch)->type_ = protocol::INNER;
 			return true;
 		}
 		else {
@@ -309,23 +553,23 @@ namespace bubi{
 						  */
 			/************************************************************************/
 
-			NodeFrm::POINTER mnode = std::make_shared< NodeFrm>(newcommon);
-			NodeFrm::POINTER newnode = std::make_shared< NodeFrm>(location);
+			NodeFrm::POINTER mnode = new NodeFrm(location.Prefix(newcommon));
+			NodeFrm::POINTER newnode = new NodeFrm(location);
 			newnode->SetValue(data);
 
-			int b1 = NextBranch(newcommon, location);
-			int b2 = NextBranch(newcommon, location2);
+			int b1 = location.At(newcommon);
+			int b2 = location2.At(newcommon);
 			mnode->SetChild(b1, newnode);
-			mnode->SetChild(b2, node2);
-			mnode->info_.mutable_children(b2)->CopyFrom(child2);
+			mnode->SetChild(b2, node->ReleaseChild(branch));
+			mnode->SetChildInfo(b2, child2);
 			node->SetChild(branch, mnode);
 			return true;
 		}
 	}
 
-	bool Trie::DeleteItem(NodeFrm::POINTER node, const Location& location){
+	bool Trie::DeleteItem(NodeFrm::POINTER node, const NibblePath& location){
 
-		Location location1 = node->location_;
+		const NibblePath& location1 = node->location_;
 		if (location1.length() > location.length()){
 			return false;
 		}
@@ -335,17 +579,14 @@ namespace bubi{
 			return true;
 		}
 
-		Location common = CommonPrefix(location1, location);
-
-		int branch = NextBranch(common, location);
+		int branch = location.At(location1.CommonPrefixLength(location));
 		NodeFrm::POINTER node2 = ChildMayFromDB(node, branch);
 		if (node2 == nullptr){
 			return false;
 		}
 
-		Location location2 = node2->location_;
-		Location common2 = CommonPrefix(location2, location);
-		if (location2 != common2){
+		const NibblePath& location2 = node2->location_;
+		if (location2.CommonPrefixLength(location) != location2.length()){
 			return false;
 		}
 		bool ret = DeleteItem(node2, location);
@@ -353,19 +594,20 @@ namespace bubi{
 		return ret;
 	}
 
-	void Trie::GetAllItem(const Location& node, const Location& location, std::vector<std::string>& result){
+	void Trie::GetAllItem(const Location& node, const NibblePath& location, std::vector<std::string>& result){
 		protocol::Node info;
-		if (!storage_load(node, info)){
+		if (node.empty() || !storage_load(node, info)){
 			return;
 		}
-		Location common = CommonPrefix(node, location);
-		if (common == location){
+		NibblePath node_path = NibblePath::FromLocation(node);
+		size_t common = node_path.CommonPrefixLength(location);
+		if (common == location.length()){
 			StorageAssociated(node, result);
 			return;
 		}
 
-		if (common == node){
-			int nextbranch = NextBranch(common, location);
+		if (common == node_path.length()){
+			int nextbranch = location.At(common);
 			Location location2 = info.children(nextbranch).sublocation();
 			GetAllItem(location2, location, result);
 		}
@@ -373,43 +615,37 @@ namespace bubi{
 	}
 
 	bool Trie::Set(const std::string& key, const std::string &value){
-		Location location = Key2Location(key);
-		return SetItem(root_, location, value, 0);
+		return SetItem(root_.get(), NibblePath::FromKey(key), value, 0);
 	}
 
 	bool Trie::Get(const std::string& key, std::string& value){
-		Location location = Key2Location(key);
-		if (!Exists(root_, location))
+		NibblePath location = NibblePath::FromKey(key);
+		if (!Exists(root_.get(), location))
 			return false;
-		return	StorageGetLeaf(location, value);
+		return	StorageGetLeaf(location.ToLocation(), value);
 	}
 
-	bool Trie::Exists(NodeFrm::POINTER node, const Location& key) {
+	bool Trie::Exists(NodeFrm::POINTER node, const NibblePath& key) {
 
 		if (node->location_ == key)
 			return true;
 
-		auto common = CommonPrefix(node->location_, key);
-		int branch = NextBranch(common, key);
+		int branch = key.At(node->location_.CommonPrefixLength(key));
 
-		if (node->info_.children(branch).childtype() == protocol::CHILDTYPE::NONE){
+		const NodeChild* child = node->GetChild(branch);
+		if (child == nullptr || child->type_ == protocol::CHILDTYPE::NONE){
 			return false;
 		}
 
-		Location location2 = node->info_.children(branch).sublocation();
-
-		auto common2 = CommonPrefix(location2, key);
-		if (common2 != location2){
+		NibblePath location2 = NibblePath::FromLocation(child->sublocation_);
+		if (location2.CommonPrefixLength(key) != location2.length()){
 			return false;
 		}
-		auto child = ChildMayFromDB(node, branch);
-		return Exists(child, key);
+		return Exists(ChildMayFromDB(node, branch), key);
 	}
 
 	void Trie::GetAll(const std::string& key, std::vector<std::string>& values){
-		Location location = Key2Location(key);
-		Location node = Key2Location("");
-		GetAllItem(node, location, values);
+		GetAllItem(rootl.ToLocation(), NibblePath::FromKey(key), values);
 	}
 
 
@@ -418,12 +654,11 @@ namespace bubi{
 	}
 
 	void Trie::UpdateHash(){
-		root_hash_ = update_hash(root_).hash();
+		root_hash_ = UpdateNodeHash(root_.get()).hash_;
 	}
 
 	bool Trie::Delete(const std::string& key){
-		Location location = Key2Location(key);
-		return DeleteItem(root_, location);
+		return DeleteItem(root_.get(), NibblePath::FromKey(key));
 	}
 
 
@@ -484,20 +719,17 @@ namespace bubi{
 	}
 
 	protocol::Node Trie::GetNode(const Location& location)	{
-		Location lc = location;
-		if (lc == ""){
-			lc.push_back(0);
-		}
-		return getNode(root_, lc);
+		return getNode(root_.get(), NibblePath::FromLocation(location));
 	}
 
-	protocol::Node Trie::getNode(NodeFrm::POINTER node, const Location& location){
+	protocol::Node Trie::getNode(NodeFrm::POINTER node, const NibblePath& location){
 		if (node->location_ == location){
-			return node->info_;
+			protocol::Node info;
+			node->ToProto(info);
+			return info;
 		}
 
-		Location common = CommonPrefix(location, node->location_);
-		int branch = NextBranch(common, location);
+		int branch = location.At(location.CommonPrefixLength(node->location_));
 
 		NodeFrm::POINTER frm = ChildMayFromDB(node, branch);
 		if (frm != nullptr){
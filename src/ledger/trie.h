@@ -2,6 +2,7 @@
 #ifndef TRIE_H_
 #define TRIE_H_
 
+#include <unordered_map>
 #include <utils/sm3.h>
 #include "proto/cpp/merkeltrie.pb.h"
 
@@ -9,48 +10,113 @@ namespace bubi{
 	typedef std::string Location;
 	typedef std::string HASH;
 
+	//nibble path of a node, Location is only used for storage and hashing
+	class NibblePath{
+	public:
+		static const size_t INLINE_BYTES = 32;
+	private:
+		size_t length_; //in nibbles
+		uint8_t inline_[INLINE_BYTES];
+		std::vector<uint8_t> heap_; //used when the path is longer than INLINE_BYTES
+
+		uint8_t* data() { return heap_.empty() ? inline_ : heap_.data(); }
+		void Resize(size_t length);
+	public:
+		NibblePath();
+
+		static NibblePath FromKey(const std::string& key);
+		static NibblePath FromLocation(const Location& location);
+		Location ToLocation() const;
+
+		const uint8_t* data() const { return heap_.empty() ? inline_ : heap_.data(); }
+		size_t length() const { return length_; }
+		int At(size_t index) const;
+		NibblePath Prefix(size_t length) const;
+		size_t CommonPrefixLength(const NibblePath& other) const;
+
+		bool operator==(const NibblePath& other) const;
+		bool operator!=(const NibblePath& other) const { return !(*this == other); }
+	};
+
+	//in-memory form of protocol::Child
+	class NodeChild{
+	public:
+		Location sublocation_;
+		HASH hash_;
+		protocol::CHILDTYPE type_;
+
+		NodeChild();
+		bool IsEmpty() const;
+	};
+
 	class NodeFrm{
 	public:
-		typedef std::shared_ptr<NodeFrm> POINTER;
-		Location location_;
-		POINTER children_[16];
-		
-		protocol::Node info_;
-		
+		//a node owns its loaded children, the pointer is only borrowed
+		typedef NodeFrm* POINTER;
+		static const int LEAF_BRANCH = 16;
+
+		NibblePath location_;
+		std::unique_ptr<NodeFrm> children_[16];
+
 		bool modified_;
 		bool leaf_deleted_;
 		std::shared_ptr<std::string> leaf_;//nullptr default
 
 		static int NEWCOUNT;
 		static int DELCOUNT;
+	private:
+		//bit i is set when branch i has an entry, entries_ keeps them in branch order
+		uint32_t mask_;
+		std::vector<NodeChild> entries_;
+
+		size_t EntryIndex(int branch) const;
 	public:
-		NodeFrm(const Location& location);
+		NodeFrm(const NibblePath& location);
 
 		~NodeFrm();
 
 		void SetValue(const std::string& v);
 		void MarkRemove();
+		//takes the ownership of child
 		void SetChild(int branch, POINTER child);
+		POINTER ReleaseChild(int branch);
+
+		const NodeChild* GetChild(int branch) const;
+		NodeChild* MutableChild(int branch);
+		void SetChildInfo(int branch, const NodeChild& child);
+		void ClearChild(int branch);
+		protocol::CHILDTYPE ChildType(int branch) const;
+
+		//protocol::Node is only used for storage and hashing
+		void FromProto(const protocol::Node& info);
+		void ToProto(protocol::Node& info) const;
+		std::string Serialize() const;
 	};
 
 	class Trie
 	{
 
-		bool SetItem(NodeFrm::POINTER node, const Location &key, const std::string &value, int depth);
-		bool DeleteItem(NodeFrm::POINTER node, const Location& key);
-		protocol::Child update_hash(NodeFrm::POINTER node);
+		bool SetItem(NodeFrm::POINTER node, const NibblePath &key, const std::string &value, int depth);
+		bool DeleteItem(NodeFrm::POINTER node, const NibblePath& key);
 
 		void Release(NodeFrm::POINTER node, int depth);
 		
-		void GetAllItem(const Location& node, const Location& location, std::vector<std::string>& result);
+		void GetAllItem(const Location& node, const NibblePath& location, std::vector<std::string>& result);
 		void StorageAssociated(const Location& location, std::vector<std::string>& result);
 	protected:
-		NodeFrm::POINTER root_;
+		std::unique_ptr<NodeFrm> root_;
 		HASH root_hash_;
-		Location rootl ;
+		NibblePath rootl ;
 		NodeFrm::POINTER ChildMayFromDB(NodeFrm::POINTER node, int branch);
+		NodeFrm::POINTER AttachChild(NodeFrm::POINTER node, int branch, const protocol::Node& info);
+		NodeChild update_hash(NodeFrm::POINTER node);
+		//hash the modified leaves under node in one multi-buffer call, then update_hash
+		NodeChild UpdateNodeHash(NodeFrm::POINTER node);
+		void CollectModifiedLeaves(NodeFrm::POINTER node, std::vector<NodeFrm::POINTER>& nodes);
+		std::unordered_map<NodeFrm::POINTER, HASH> leaf_hashes_;
 
 		virtual bool storage_load(const Location& location, protocol::Node& info) = 0;
+		virtual void storage_multi_load(const std::vector<Location>& locations, std::vector<protocol::Node>& infos, std::vector<bool>& founds);
 
 		virtual void StorageSaveNode(NodeFrm::POINTER node) = 0;
 		virtual void StorageSaveLeaf(NodeFrm::POINTER node) = 0;
@@ -59,8 +125,9 @@ namespace bubi{
 
 		virtual bool StorageGetLeaf(const Location& location, std::string& value) = 0;
 		virtual std::string HashCrypto(const std::string& input) = 0;
+		virtual void HashCryptoMulti(const std::vector<const std::string*>& inputs, std::vector<std::string>& outputs);
 		
-		protocol::Node getNode(NodeFrm::POINTER node, const Location& location);
+		protocol::Node getNode(NodeFrm::POINTER node, const NibblePath& location);
 	public:
 		static const char EVEN_PREFIX = 0x00;
 		static const char ODD_PREFIX = 0x01;
@@ -77,25 +144,27 @@ namespace bubi{
 		//return false if not exists else return true
 		bool Get(const std::string& key, std::string& value);
 
-		bool Exists(NodeFrm::POINTER node, const Location& key);
+		bool Exists(NodeFrm::POINTER node, const NibblePath& key);
 
-		void GetAll(const std::string& key, std::vector<std::string>& values);
+		virtual void GetAll(const std::string& key, std::vector<std::string>& values);
 
 		//return false if not exists else return true
 		bool Delete(const std::string& key);
 
+		//load the inner nodes on the paths of keys, one batch per level
+		void Prefetch(const std::vector<std::string>& keys);
+
 		HASH GetRootHash();
 
-		void UpdateHash();
+		virtual void UpdateHash();
 
 		void FreeMemory(int depth);
 	
 		protocol::Node GetNode(const Location& key);
 
 	public:
-		static Location CommonPrefix(const Location& s1, const Location& s2);
-		static int NextBranch(const Location &s1, const Location& s2);
-		static Location Key2Location(const std::string& key);
+		static NibblePath CommonPrefix(const NibblePath& s1, const NibblePath& s2);
+		static int NextBranch(const NibblePath &s1, const NibblePath& s2);
 	};
 }
 
@@ -120,6 +120,11 @@ namespace bubi {
 		max_trans_in_memory_ = 100000;
 		max_ledger_per_message_ = 5;
 		max_apply_ledger_per_round_ = 3;
+		apply_thread_count_ = 0;
+		trie_cache_size_ = 256;
+		account_trie_cache_count_ = 5000;
+		signature_cache_count_ = 200000;
+		persist_queue_size_ = 2;
 		test_model_ = false;
 	}
 
@@ -133,6 +138,11 @@ namespace bubi {
 		Configure::GetValue(value, "max_ledger_per_message", max_ledger_per_message_);
 		Configure::GetValue(value, "max_apply_ledger_per_round", max_apply_ledger_per_round_);
 		Configure::GetValue(value, "max_trans_in_memory", max_trans_in_memory_);
+		Configure::GetValue(value, "apply_thread_count", apply_thread_count_);
+		Configure::GetValue(value, "trie_cache_size", trie_cache_size_);
+		Configure::GetValue(value, "account_trie_cache_count", account_trie_cache_count_);
+		Configure::GetValue(value, "signature_cache_count", signature_cache_count_);
+		Configure::GetValue(value, "persist_queue_size", persist_queue_size_);
 		Configure::GetValue(value, "test_model", test_model_);
 		Configure::GetValue(value, "genesis_account", genesis_account_);
 		Configure::GetValue(value, "hardfork_points", hardfork_points_);
@@ -202,7 +212,10 @@ namespace bubi {
 			return false;
 		}
 
-		db_configure_.Load(values["db"]);
+		if (!db_configure_.Load(values["db"])) {
+			LOG_STD_ERR("Load db configuration failed");
+			return false;
+		}
 		logger_configure_.Load(values["logger"]);
 		p2p_configure_.Load(values["p2p"]);
 		webserver_configure_.Load(values["webserver"]);
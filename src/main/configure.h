@@ -77,6 +77,11 @@ namespace bubi {
 		uint32_t max_ledger_per_message_;
 		uint32_t max_trans_in_memory_;
 		uint32_t max_apply_ledger_per_round_;
+		uint32_t apply_thread_count_; //0: cpu core count, 1: apply transactions serially
+		uint32_t trie_cache_size_; //MB, 0: disable the account trie node cache
+		uint32_t account_trie_cache_count_; //accounts whose asset and metadata tries are kept in memory
+		uint32_t signature_cache_count_; //transactions whose verified signers are kept, 0: disable
+		uint32_t persist_queue_size_; //closed ledgers waiting to be written, 0: write while closing
 		bool test_model_;
 		std::string genesis_account_;
 		utils::StringList hardfork_points_;
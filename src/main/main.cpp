@@ -177,6 +177,11 @@ int main(int argc, char *argv[]){
 		bubiAtExit.Push(std::bind(&bubi::LedgerManager::Exit, &ledgermanger));
 		LOG_INFO("Initialize ledger successful");
 
+		if (!arg.replay_path_.empty()) {
+			bubi::ContractManager::Initialize(argc, argv);
+			return ledgermanger.Replay(arg.replay_path_, arg.replay_end_seq_) ? 0 : 1;
+		}
+
 		bubi::GlueManager &glue = bubi::GlueManager::Instance();
 		if (!bubi::g_enable_ || !glue.Initialize()){
 			LOG_ERROR("Initialize glue manager failed");
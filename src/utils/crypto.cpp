@@ -207,6 +207,84 @@ namespace utils {
 		SHA256_Final(buf, &sha256);
 	}
 
+#if defined(__x86_64__) && !defined(OPENSSL_NO_ASM)
+	//the multi-buffer sha256 of the x86_64 libcrypto, it picks SHA-NI, AVX2, AVX or SSE from OPENSSL_ia32cap_P
+	extern "C" {
+		typedef struct {
+			unsigned int A[8], B[8], C[8], D[8], E[8], F[8], G[8], H[8];
+		} SHA256_MB_CTX;
+		typedef struct {
+			const unsigned char *ptr;
+			int blocks;
+		} SHA256_MB_DESC;
+		void sha256_multi_block(SHA256_MB_CTX *ctx, const SHA256_MB_DESC *inp, int num);
+	}
+
+	static void Sha256MultiLanes(const std::string *const *inputs, size_t count, std::string *outputs) {
+		static const unsigned int init[8] = {
+			0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+		};
+
+		SHA256_MB_CTX ctx;
+		unsigned int *state[8] = { ctx.A, ctx.B, ctx.C, ctx.D, ctx.E, ctx.F, ctx.G, ctx.H };
+		for (size_t w = 0; w < 8; w++) {
+			for (size_t lane = 0; lane < 8; lane++) {
+				state[w][lane] = init[w];
+			}
+		}
+
+		//every lane is hashed whole in one call. A lane group of the asm (4 lanes, 2 with SHA-NI) without any
+		//block ends the call and skips the groups after it, so the used lanes come first and each has a block at least
+		SHA256_MB_DESC desc[8];
+		std::string padded[8];
+		for (size_t lane = 0; lane < 8; lane++) {
+			desc[lane].ptr = NULL;
+			desc[lane].blocks = 0;
+			if (lane >= count) {
+				continue;
+			}
+
+			size_t size = inputs[lane]->size();
+			size_t blocks = (size + 8) / 64 + 1;
+			padded[lane].reserve(blocks * 64);
+			padded[lane].assign(*inputs[lane]);
+			padded[lane].push_back((char)0x80);
+			padded[lane].resize(blocks * 64 - 8, 0);
+			uint64_t bits = (uint64_t)size * 8;
+			for (size_t i = 0; i < 8; i++) {
+				padded[lane].push_back((char)(bits >> (56 - 8 * i)));
+			}
+			desc[lane].ptr = (const unsigned char *)padded[lane].c_str();
+			desc[lane].blocks = (int)blocks;
+		}
+		sha256_multi_block(&ctx, desc, 2);
+
+		for (size_t lane = 0; lane < count; lane++) {
+			outputs[lane].resize(32);
+			unsigned char *out = (unsigned char *)outputs[lane].c_str();
+			for (size_t w = 0; w < 8; w++) {
+				out[4 * w] = (unsigned char)(state[w][lane] >> 24);
+				out[4 * w + 1] = (unsigned char)(state[w][lane] >> 16);
+				out[4 * w + 2] = (unsigned char)(state[w][lane] >> 8);
+				out[4 * w + 3] = (unsigned char)state[w][lane];
+			}
+		}
+	}
+#endif
+
+	void Sha256::CryptoMulti(const std::vector<const std::string *> &inputs, std::vector<std::string> &outputs) {
+		outputs.resize(inputs.size());
+#if defined(__x86_64__) && !defined(OPENSSL_NO_ASM)
+		for (size_t i = 0; i < inputs.size(); i += 8) {
+			Sha256MultiLanes(&inputs[i], std::min((size_t)8, inputs.size() - i), &outputs[i]);
+		}
+#else
+		for (size_t i = 0; i < inputs.size(); i++) {
+			Crypto(*inputs[i], outputs[i]);
+		}
+#endif
+	}
+
 	std::string Base58::Encode(const std::string &str_in) {
 		std::string strOut;
 		int zeros = 0;
@@ -76,6 +76,9 @@ namespace utils {
 		static void Crypto(unsigned char* str, int len, unsigned char *buf);
 
 		static void Crypto(const std::string &input, std::string &str);
+
+		//hashes 8 inputs at a time with the multi-buffer code of libcrypto on x86_64, one by one elsewhere
+		static void CryptoMulti(const std::vector<const std::string *> &inputs, std::vector<std::string> &outputs);
 		//static void Crypto(unsigned char* str1, int len1, unsigned char *str2, int len2, unsigned char *buf);
 		//static void Crypto(unsigned char* str1, int len1, unsigned char* str2, int len2, unsigned char *str3, int len3, unsigned char *buf);
 	public:
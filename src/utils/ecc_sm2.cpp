@@ -48,6 +48,12 @@ namespace utils {
 	}
 
 	EC_GROUP* EccSm2::GetCFCAGroup() {
+		//built once, the first verifications may come from several threads at the same time
+		static EC_GROUP* group = NewCFCAGroup();
+		return group;
+	}
+
+	EC_GROUP* EccSm2::NewCFCAGroup() {
 		if (cfca_group_ != NULL) {
 			return cfca_group_;
 		}
@@ -76,6 +82,8 @@ namespace utils {
 			if (!EC_GROUP_set_generator(cfca_group_, G, n, BN_value_one())) {
 				break;
 			}
+			//生成元的倍点表, 签名的kG和验证的sG都用它
+			EC_GROUP_precompute_mult(cfca_group_, ctx);
 		} while (false);
 		free_ec_point(G);
 		return cfca_group_;
@@ -292,6 +300,34 @@ namespace utils {
 		return ZA;
 	}
 
+	std::string EccSm2::getZA(EC_GROUP* group, std::string id, const std::string& pkey) {
+		EC_POINT* pub_key = NewPublicKeyPoint(group, pkey);
+		std::string ZA = getZA(group, id, pub_key);
+		free_ec_point(pub_key);
+		return ZA;
+	}
+
+	EC_POINT* EccSm2::NewPublicKeyPoint(EC_GROUP* group, const std::string& pkey) {
+		int len = (pkey.size() - 1) / 2;
+		std::string px = pkey.substr(1, len);
+		std::string py = pkey.substr(1 + len, len);
+
+		BIGNUM* xp = BN_new();
+		BIGNUM* yp = BN_new();
+		EC_POINT* pub_key = EC_POINT_new(group);
+		BN_bin2bn((const unsigned char*)px.c_str(), px.size(), xp);
+		BN_bin2bn((const unsigned char*)py.c_str(), py.size(), yp);
+		if (EC_METHOD_get_field_type(EC_GROUP_method_of(group)) == NID_X9_62_prime_field) {
+			EC_POINT_set_affine_coordinates_GFp(group, pub_key, xp, yp, NULL);
+		}
+		else {
+			EC_POINT_set_affine_coordinates_GF2m(group, pub_key, xp, yp, NULL);
+		}
+		free_bn(xp);
+		free_bn(yp);
+		return pub_key;
+	}
+
 	bool  EccSm2::From(std::string skey_bin) {
 		valid_ = false;
 		skey_bin_ = skey_bin;
@@ -530,25 +566,30 @@ namespace utils {
 
 	int EccSm2::verify(EC_GROUP* group, const std::string& pkey, 
 		const std::string& id, const std::string& msg, const std::string& strsig) {
-		std::string px = "";
-		std::string py = "";
-		int len = (pkey.size() - 1) / 2;
-		px = pkey.substr(1, len);
-		py = pkey.substr(1 + len, len);
+		return verifyZA(group, pkey, getZA(group, id, pkey), msg, strsig);
+	}
 
+	int EccSm2::verifyZA(EC_GROUP* group, const std::string& pkey,
+		const std::string& ZA, const std::string& msg, const std::string& strsig) {
+		EC_POINT* pub_key = NewPublicKeyPoint(group, pkey);
+		int ret = verifyZA(group, pub_key, ZA, msg, strsig);
+		free_ec_point(pub_key);
+		return ret;
+	}
+
+	int EccSm2::verifyZA(EC_GROUP* group, const EC_POINT* pub_key,
+		const std::string& ZA, const std::string& msg, const std::string& strsig) {
 		std::string sigr = strsig.substr(0, strsig.size() / 2);
 		std::string sigs = strsig.substr(strsig.size() / 2, strsig.size() / 2);
 
 		int ret = -1;
-		EC_POINT *pub_key = NULL;
 		EC_POINT *point = NULL;
 		BN_CTX *ctx = NULL;
 
 		ECDSA_SIG* sig = NULL;
 
-		std::string M, ZA, stre;
+		std::string M, stre;
 
-		pub_key = EC_POINT_new(group);
 		point = EC_POINT_new(group);
 		unsigned char dgst[32];
 		int dgstlen;
@@ -556,8 +597,6 @@ namespace utils {
 		ctx = BN_CTX_new();
 		BN_CTX_start(ctx);
 
-		BIGNUM* xp = BN_CTX_get(ctx);
-		BIGNUM* yp = BN_CTX_get(ctx);
 		BIGNUM*x1 = BN_CTX_get(ctx);
 		BIGNUM*R = BN_CTX_get(ctx);
 		BIGNUM *order = BN_CTX_get(ctx);
@@ -565,14 +604,6 @@ namespace utils {
 		BIGNUM *t = BN_CTX_get(ctx);
 
 		EC_GROUP_get_order(group, order, ctx);
-		BN_bin2bn((const unsigned char*)px.c_str(), px.size(), xp);
-		BN_bin2bn((const unsigned char*)py.c_str(), py.size(), yp);
-		if (EC_METHOD_get_field_type(EC_GROUP_method_of(group)) == NID_X9_62_prime_field) {
-			EC_POINT_set_affine_coordinates_GFp(group, pub_key, xp, yp, NULL);
-		}
-		else {
-			EC_POINT_set_affine_coordinates_GF2m(group, pub_key, xp, yp, NULL);
-		}
 
 		sig = ECDSA_SIG_new();
 		BN_bin2bn((const unsigned char*)sigr.c_str(), sigr.size(), sig->r);
@@ -605,7 +636,6 @@ namespace utils {
 		}
 
 		//第3步 计算 _M = ZA||M'
-		ZA = getZA(group, id, pub_key);
 		M = ZA + msg;
 
 		//第4步  计算e' = Hv(_M)
@@ -656,7 +686,6 @@ namespace utils {
 
 	end:
 		free_ec_point(point);
-		free_ec_point(pub_key);
 
 		BN_CTX_end(ctx);
 		BN_CTX_free(ctx);
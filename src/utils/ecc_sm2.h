@@ -57,11 +57,25 @@ namespace utils{
 		static int verify(EC_GROUP* group, const std::string& pkey,
 			const std::string& id, const std::string& msg, const std::string& sig);
 
+		//同verify, ZA由getZA预先算好, 同一公钥多次验证时可以缓存
+		static int verifyZA(EC_GROUP* group, const std::string& pkey,
+			const std::string& ZA, const std::string& msg, const std::string& sig);
+
+		//同上, 公钥点由NewPublicKeyPoint预先生成
+		static int verifyZA(EC_GROUP* group, const EC_POINT* pub_key,
+			const std::string& ZA, const std::string& msg, const std::string& sig);
+
 		//group 椭圆曲线
 		//id  身份
 		//pkey  公钥点
 		static std::string getZA(EC_GROUP* group, std::string id, const EC_POINT* pkey);
 
+		//pkey  未压缩的公钥(字节流)
+		static std::string getZA(EC_GROUP* group, std::string id, const std::string& pkey);
+
+		//由未压缩的公钥(字节流)生成公钥点, 需要用EC_POINT_free释放
+		static EC_POINT* NewPublicKeyPoint(EC_GROUP* group, const std::string& pkey);
+
 		//返回16进制私钥
         std::string getSkeyHex();
 
@@ -80,6 +94,8 @@ namespace utils{
     private:
         EC_GROUP* group_;
 
+		static EC_GROUP* NewCFCAGroup();
+
 		static EC_GROUP* cfca_group_;
     };
 
@@ -1,5 +1,8 @@
 
 #include "sm3.h"
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#endif
 
 namespace utils {
 
@@ -97,28 +100,64 @@ namespace utils {
 
 	}
 
+#define FF0(x,y,z) ( (x) ^ (y) ^ (z))
+#define FF1(x,y,z) (((x) & (y)) | (((x) | (y)) & (z)))
+
+#define GG0(x,y,z) ( (x) ^ (y) ^ (z))
+#define GG1(x,y,z) (((x) & (y)) | ( (~(x)) & (z)) )
+
+#define ROTL(x,n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define P0(x) ((x) ^  ROTL((x),9) ^ ROTL((x),17))
+#define P1(x) ((x) ^  ROTL((x),15) ^ ROTL((x),23))
+
+	//T[j] rotated left by j mod 32, so the rounds do not rotate the constant
+	static const uint32_t sm3_t[64] = {
+		0x79CC4519, 0xF3988A32, 0xE7311465, 0xCE6228CB, 0x9CC45197, 0x3988A32F, 0x7311465E, 0xE6228CBC,
+		0xCC451979, 0x988A32F3, 0x311465E7, 0x6228CBCE, 0xC451979C, 0x88A32F39, 0x11465E73, 0x228CBCE6,
+		0x9D8A7A87, 0x3B14F50F, 0x7629EA1E, 0xEC53D43C, 0xD8A7A879, 0xB14F50F3, 0x629EA1E7, 0xC53D43CE,
+		0x8A7A879D, 0x14F50F3B, 0x29EA1E76, 0x53D43CEC, 0xA7A879D8, 0x4F50F3B1, 0x9EA1E762, 0x3D43CEC5,
+		0x7A879D8A, 0xF50F3B14, 0xEA1E7629, 0xD43CEC53, 0xA879D8A7, 0x50F3B14F, 0xA1E7629E, 0x43CEC53D,
+		0x879D8A7A, 0x0F3B14F5, 0x1E7629EA, 0x3CEC53D4, 0x79D8A7A8, 0xF3B14F50, 0xE7629EA1, 0xCEC53D43,
+		0x9D8A7A87, 0x3B14F50F, 0x7629EA1E, 0xEC53D43C, 0xD8A7A879, 0xB14F50F3, 0x629EA1E7, 0xC53D43CE,
+		0x8A7A879D, 0x14F50F3B, 0x29EA1E76, 0x53D43CEC, 0xA7A879D8, 0x4F50F3B1, 0x9EA1E762, 0x3D43CEC5,
+	};
+
+	//W[j] of the message expansion, W'[j] is W[j] ^ W[j + 4] and is folded into the round
+#define SM3_EXPAND(W, j) \
+	(W[j] = P1(W[(j) - 16] ^ W[(j) - 9] ^ ROTL(W[(j) - 3], 15)) ^ ROTL(W[(j) - 13], 7) ^ W[(j) - 6])
+
+	//one round without moving the registers, the caller rotates the names instead:
+	//B and F are rotated in place, D takes TT1 (the new A) and H takes P0(TT2) (the new E)
+#define SM3_ROUND(A, B, C, D, E, F, G, H, FF, GG, j) {              \
+		uint32_t a12 = ROTL(A, 12);                                 \
+		uint32_t ss1 = ROTL(a12 + E + sm3_t[j], 7);                 \
+		uint32_t ss2 = ss1 ^ a12;                                   \
+		uint32_t tt1 = FF(A, B, C) + D + ss2 + (W[j] ^ W[(j) + 4]); \
+		uint32_t tt2 = GG(E, F, G) + H + ss1 + W[j];                \
+		B = ROTL(B, 9);                                             \
+		D = tt1;                                                    \
+		F = ROTL(F, 19);                                            \
+		H = P0(tt2);                                                \
+	}
+
+#define SM3_ROUNDS4(FF, GG, j)                                      \
+	SM3_ROUND(A, B, C, D, E, F, G, H, FF, GG, (j));                 \
+	SM3_ROUND(D, A, B, C, H, E, F, G, FF, GG, (j) + 1);             \
+	SM3_ROUND(C, D, A, B, G, H, E, F, FF, GG, (j) + 2);             \
+	SM3_ROUND(B, C, D, A, F, G, H, E, FF, GG, (j) + 3)
+
+	//expands the four words needed by the next four rounds, then runs them
+#define SM3_EXPAND_ROUNDS4(FF, GG, j)                               \
+	SM3_EXPAND(W, (j) + 4); SM3_EXPAND(W, (j) + 5);                 \
+	SM3_EXPAND(W, (j) + 6); SM3_EXPAND(W, (j) + 7);                 \
+	SM3_ROUNDS4(FF, GG, j)
+
 	void Sm3::sm3_process(sm3_context *ctx, unsigned char data[64]) {
-		uint32_t SS1, SS2, TT1, TT2, W[68], W1[64];
+		uint32_t W[68];
 		uint32_t A, B, C, D, E, F, G, H;
-		uint32_t T[64];
-		uint32_t Temp1, Temp2, Temp3, Temp4, Temp5;
-		int j;
-		/*
-		#ifdef _DEBUG
-		int i;
-		#endif
-		*/
-		//  for(j=0; j < 68; j++)
-		//      W[j] = 0;
-		//  for(j=0; j < 64; j++)
-		//      W1[j] = 0;
-
-		for (j = 0; j < 16; j++)
-			T[j] = 0x79CC4519;
-		for (j = 16; j < 64; j++)
-			T[j] = 0x7A879D8A;
-
-		GET_ULONG_BE(W[0], data, 0);  //W[0]=data[0] data[1] data[2] data[3]
+
+		GET_ULONG_BE(W[0], data, 0);
 		GET_ULONG_BE(W[1], data, 4);
 		GET_ULONG_BE(W[2], data, 8);
 		GET_ULONG_BE(W[3], data, 12);
@@ -134,132 +173,211 @@ namespace utils {
 		GET_ULONG_BE(W[13], data, 52);
 		GET_ULONG_BE(W[14], data, 56);
 		GET_ULONG_BE(W[15], data, 60);
-		/*
-		#ifdef _DEBUG
-		printf("Message with padding:\n");
-		for (i = 0; i < 8; i++)
-		printf("%08x ", W[i]);
-		printf("\n");
-		for (i = 8; i < 16; i++)
-		printf("%08x ", W[i]);
-		printf("\n");
-		#endif
-		*/
-
-#define FF0(x,y,z) ( (x) ^ (y) ^ (z)) 
-#define FF1(x,y,z) (((x) & (y)) | ( (x) & (z)) | ( (y) & (z)))
-
-#define GG0(x,y,z) ( (x) ^ (y) ^ (z)) 
-#define GG1(x,y,z) (((x) & (y)) | ( (~(x)) & (z)) )
 
+		A = (uint32_t)ctx->state[0];
+		B = (uint32_t)ctx->state[1];
+		C = (uint32_t)ctx->state[2];
+		D = (uint32_t)ctx->state[3];
+		E = (uint32_t)ctx->state[4];
+		F = (uint32_t)ctx->state[5];
+		G = (uint32_t)ctx->state[6];
+		H = (uint32_t)ctx->state[7];
+
+		SM3_ROUNDS4(FF0, GG0, 0);
+		SM3_ROUNDS4(FF0, GG0, 4);
+		SM3_ROUNDS4(FF0, GG0, 8);
+		SM3_EXPAND_ROUNDS4(FF0, GG0, 12);
+		SM3_EXPAND_ROUNDS4(FF1, GG1, 16);
+		SM3_EXPAND_ROUNDS4(FF1, GG1, 20);
+		SM3_EXPAND_ROUNDS4(FF1, GG1, 24);
+		SM3_EXPAND_ROUNDS4(FF1, GG1, 28);
+		SM3_EXPAND_ROUNDS4(FF1, GG1, 32);
+		SM3_EXPAND_ROUNDS4(FF1, GG1, 36);
+		SM3_EXPAND_ROUNDS4(FF1, GG1, 40);
+		SM3_EXPAND_ROUNDS4(FF1, GG1, 44);
+		SM3_EXPAND_ROUNDS4(FF1, GG1, 48);
+		SM3_EXPAND_ROUNDS4(FF1, GG1, 52);
+		SM3_EXPAND_ROUNDS4(FF1, GG1, 56);
+		SM3_EXPAND_ROUNDS4(FF1, GG1, 60);
 
-#define  SHL(x,n) (((x) & 0xFFFFFFFF) << n)
-#define ROTL(x,n) (SHL((x),n) | ((x) >> (32 - n)))
-
-#define P0(x) ((x) ^  ROTL((x),9) ^ ROTL((x),17)) 
-#define P1(x) ((x) ^  ROTL((x),15) ^ ROTL((x),23)) 
+		ctx->state[0] ^= A;
+		ctx->state[1] ^= B;
+		ctx->state[2] ^= C;
+		ctx->state[3] ^= D;
+		ctx->state[4] ^= E;
+		ctx->state[5] ^= F;
+		ctx->state[6] ^= G;
+		ctx->state[7] ^= H;
+	}
 
-		for (j = 16; j < 68; j++) {
-			//W[j] = P1( W[j-16] ^ W[j-9] ^ ROTL(W[j-3],15)) ^ ROTL(W[j - 13],7 ) ^ W[j-6];
-			//Why thd release's result is different with the debug's ?
-			//Below is okay. Interesting, Perhaps VC6 has a bug of Optimizaiton.
+#if defined(__GNUC__) && defined(__x86_64__)
+	//the same compression on 8 lanes of avx2, a lane per message
+#define V_XOR(x,y) _mm256_xor_si256((x), (y))
+#define V_AND(x,y) _mm256_and_si256((x), (y))
+#define V_OR(x,y) _mm256_or_si256((x), (y))
+#define V_ADD(x,y) _mm256_add_epi32((x), (y))
+#define V_ROTL(x,n) _mm256_or_si256(_mm256_slli_epi32((x), (n)), _mm256_srli_epi32((x), 32 - (n)))
+
+#define V_FF0(x,y,z) V_XOR(V_XOR((x), (y)), (z))
+#define V_FF1(x,y,z) V_OR(V_AND((x), (y)), V_AND(V_OR((x), (y)), (z)))
+#define V_GG0(x,y,z) V_XOR(V_XOR((x), (y)), (z))
+#define V_GG1(x,y,z) V_OR(V_AND((x), (y)), _mm256_andnot_si256((x), (z)))
+
+#define V_P0(x) V_XOR(V_XOR((x), V_ROTL((x), 9)), V_ROTL((x), 17))
+#define V_P1(x) V_XOR(V_XOR((x), V_ROTL((x), 15)), V_ROTL((x), 23))
+
+#define V_EXPAND(W, j) \
+	(W[j] = V_XOR(V_XOR(V_P1(V_XOR(V_XOR(W[(j) - 16], W[(j) - 9]), V_ROTL(W[(j) - 3], 15))), V_ROTL(W[(j) - 13], 7)), W[(j) - 6]))
+
+#define V_ROUND(A, B, C, D, E, F, G, H, FF, GG, j) {                                  \
+		__m256i a12 = V_ROTL(A, 12);                                                  \
+		__m256i ss1 = V_ROTL(V_ADD(V_ADD(a12, E), _mm256_set1_epi32((int)sm3_t[j])), 7); \
+		__m256i ss2 = V_XOR(ss1, a12);                                                \
+		__m256i tt1 = V_ADD(V_ADD(FF(A, B, C), D), V_ADD(ss2, V_XOR(W[j], W[(j) + 4]))); \
+		__m256i tt2 = V_ADD(V_ADD(GG(E, F, G), H), V_ADD(ss1, W[j]));                 \
+		B = V_ROTL(B, 9);                                                             \
+		D = tt1;                                                                      \
+		F = V_ROTL(F, 19);                                                            \
+		H = V_P0(tt2);                                                                \
+	}
 
-			Temp1 = W[j - 16] ^ W[j - 9];
-			Temp2 = ROTL(W[j - 3], 15);
-			Temp3 = Temp1 ^ Temp2;
-			Temp4 = P1(Temp3);
-			Temp5 = ROTL(W[j - 13], 7) ^ W[j - 6];
-			W[j] = Temp4 ^ Temp5;
+#define V_ROUNDS4(FF, GG, j)                                        \
+	V_ROUND(A, B, C, D, E, F, G, H, FF, GG, (j));                   \
+	V_ROUND(D, A, B, C, H, E, F, G, FF, GG, (j) + 1);               \
+	V_ROUND(C, D, A, B, G, H, E, F, FF, GG, (j) + 2);               \
+	V_ROUND(B, C, D, A, F, G, H, E, FF, GG, (j) + 3)
+
+#define V_EXPAND_ROUNDS4(FF, GG, j)                                 \
+	V_EXPAND(W, (j) + 4); V_EXPAND(W, (j) + 5);                     \
+	V_EXPAND(W, (j) + 6); V_EXPAND(W, (j) + 7);                     \
+	V_ROUNDS4(FF, GG, j)
+
+	//state is word major, state[w][lane]; a lane whose active word is 0 keeps its state
+	__attribute__((target("avx2")))
+	static void Sm3ProcessLanes8(uint32_t state[8][8], const unsigned char *const data[8], const uint32_t active[8]) {
+		__m256i W[68];
+		uint32_t words[8];
+		for (int j = 0; j < 16; j++) {
+			for (int lane = 0; lane < 8; lane++) {
+				GET_ULONG_BE(words[lane], data[lane], 4 * j);
+			}
+			W[j] = _mm256_loadu_si256((const __m256i *)words);
 		}
 
-		/*
-		#ifdef _DEBUG
-		printf("Expanding message W0-67:\n");
-		for (i = 0; i < 68; i++)
-		{
-		printf("%08x ", W[i]);
-		if (((i + 1) % 8) == 0) printf("\n");
+		__m256i V[8];
+		for (int w = 0; w < 8; w++) {
+			V[w] = _mm256_loadu_si256((const __m256i *)state[w]);
+		}
+		__m256i A = V[0], B = V[1], C = V[2], D = V[3], E = V[4], F = V[5], G = V[6], H = V[7];
+
+		V_ROUNDS4(V_FF0, V_GG0, 0);
+		V_ROUNDS4(V_FF0, V_GG0, 4);
+		V_ROUNDS4(V_FF0, V_GG0, 8);
+		V_EXPAND_ROUNDS4(V_FF0, V_GG0, 12);
+		V_EXPAND_ROUNDS4(V_FF1, V_GG1, 16);
+		V_EXPAND_ROUNDS4(V_FF1, V_GG1, 20);
+		V_EXPAND_ROUNDS4(V_FF1, V_GG1, 24);
+		V_EXPAND_ROUNDS4(V_FF1, V_GG1, 28);
+		V_EXPAND_ROUNDS4(V_FF1, V_GG1, 32);
+		V_EXPAND_ROUNDS4(V_FF1, V_GG1, 36);
+		V_EXPAND_ROUNDS4(V_FF1, V_GG1, 40);
+		V_EXPAND_ROUNDS4(V_FF1, V_GG1, 44);
+		V_EXPAND_ROUNDS4(V_FF1, V_GG1, 48);
+		V_EXPAND_ROUNDS4(V_FF1, V_GG1, 52);
+		V_EXPAND_ROUNDS4(V_FF1, V_GG1, 56);
+		V_EXPAND_ROUNDS4(V_FF1, V_GG1, 60);
+
+		__m256i mask = _mm256_loadu_si256((const __m256i *)active);
+		__m256i R[8] = { A, B, C, D, E, F, G, H };
+		for (int w = 0; w < 8; w++) {
+			_mm256_storeu_si256((__m256i *)state[w], V_XOR(V[w], V_AND(R[w], mask)));
 		}
-		printf("\n");
-		#endif
-		*/
+	}
+
+	static bool Sm3HasAvx2() {
+		static const bool has_avx2 = __builtin_cpu_supports("avx2") != 0;
+		return has_avx2;
+	}
+
+	//pads up to 8 messages and runs them through the lanes together, the shorter ones idle at the end
+	static void Sm3MultiLanes(const std::string *const *inputs, size_t count, std::string *outputs) {
+		static const uint32_t init[8] = {
+			0x7380166F, 0x4914B2B9, 0x172442D7, 0xDA8A0600, 0xA96F30BC, 0x163138AA, 0xE38DEE4D, 0xB0FB0E4E
+		};
 
-		for (j = 0; j < 64; j++) {
-			W1[j] = W[j] ^ W[j + 4];
+		uint32_t state[8][8];
+		for (size_t w = 0; w < 8; w++) {
+			for (size_t lane = 0; lane < 8; lane++) {
+				state[w][lane] = init[w];
+			}
 		}
 
-		/*#ifdef _DEBUG
-		printf("Expanding message W'0-63:\n");
-		for (i = 0; i < 64; i++)
-		{
-		printf("%08x ", W1[i]);
-		if (((i + 1) % 8) == 0) printf("\n");
+		unsigned char tails[8][128];
+		size_t whole_blocks[8], total_blocks[8];
+		size_t max_blocks = 0;
+		memset(tails, 0, sizeof(tails));
+		for (size_t lane = 0; lane < 8; lane++) {
+			whole_blocks[lane] = 0;
+			total_blocks[lane] = 0;
+			if (lane >= count) {
+				continue;
+			}
+
+			size_t size = inputs[lane]->size();
+			size_t tail = size % 64;
+			size_t tail_blocks = tail < 56 ? 1 : 2;
+			memcpy(tails[lane], inputs[lane]->c_str() + size - tail, tail);
+			tails[lane][tail] = 0x80;
+			uint64_t bits = (uint64_t)size * 8;
+			for (size_t i = 0; i < 8; i++) {
+				tails[lane][tail_blocks * 64 - 1 - i] = (unsigned char)(bits >> (8 * i));
+			}
+			whole_blocks[lane] = size / 64;
+			total_blocks[lane] = whole_blocks[lane] + tail_blocks;
+			max_blocks = std::max(max_blocks, total_blocks[lane]);
 		}
-		printf("\n");
-		#endif
-		*/
-
-		A = ctx->state[0];
-		B = ctx->state[1];
-		C = ctx->state[2];
-		D = ctx->state[3];
-		E = ctx->state[4];
-		F = ctx->state[5];
-		G = ctx->state[6];
-		H = ctx->state[7];
-		//#ifdef _DEBUG       
-		//		printf("j     A       B        C         D         E        F        G       H\n");
-		//		printf("   %08x %08x %08x %08x %08x %08x %08x %08x\n", A, B, C, D, E, F, G, H);
-		//#endif
-
-		for (j = 0; j < 16; j++) {
-			SS1 = ROTL((ROTL(A, 12) + E + ROTL(T[j], j)), 7);
-			SS2 = SS1 ^ ROTL(A, 12);
-			TT1 = FF0(A, B, C) + D + SS2 + W1[j];
-			TT2 = GG0(E, F, G) + H + SS1 + W[j];
-			D = C;
-			C = ROTL(B, 9);
-			B = A;
-			A = TT1;
-			H = G;
-			G = ROTL(F, 19);
-			F = E;
-			E = P0(TT2);
-			//#ifdef _DEBUG 
-			//			printf("%02d %08x %08x %08x %08x %08x %08x %08x %08x\n", j, A, B, C, D, E, F, G, H);
-			//#endif
+
+		const unsigned char *data[8];
+		uint32_t active[8];
+		for (size_t block = 0; block < max_blocks; block++) {
+			for (size_t lane = 0; lane < 8; lane++) {
+				active[lane] = block < total_blocks[lane] ? 0xFFFFFFFF : 0;
+				if (block < whole_blocks[lane]) {
+					data[lane] = (const unsigned char *)inputs[lane]->c_str() + 64 * block;
+				}
+				else if (block < total_blocks[lane]) {
+					data[lane] = tails[lane] + 64 * (block - whole_blocks[lane]);
+				}
+				else {
+					data[lane] = tails[lane];
+				}
+			}
+			Sm3ProcessLanes8(state, data, active);
 		}
 
-		for (j = 16; j < 64; j++) {
-			SS1 = ROTL((ROTL(A, 12) + E + ROTL(T[j], j)), 7);
-			SS2 = SS1 ^ ROTL(A, 12);
-			TT1 = FF1(A, B, C) + D + SS2 + W1[j];
-			TT2 = GG1(E, F, G) + H + SS1 + W[j];
-			D = C;
-			C = ROTL(B, 9);
-			B = A;
-			A = TT1;
-			H = G;
-			G = ROTL(F, 19);
-			F = E;
-			E = P0(TT2);
-			//#ifdef _DEBUG 
-			//			printf("%02d %08x %08x %08x %08x %08x %08x %08x %08x\n", j, A, B, C, D, E, F, G, H);
-			//#endif  
+		for (size_t lane = 0; lane < count; lane++) {
+			outputs[lane].resize(32);
+			unsigned char *out = (unsigned char *)outputs[lane].c_str();
+			for (size_t w = 0; w < 8; w++) {
+				PUT_ULONG_BE(state[w][lane], out, 4 * w);
+			}
 		}
+	}
+#endif
 
-		ctx->state[0] ^= A;
-		ctx->state[1] ^= B;
-		ctx->state[2] ^= C;
-		ctx->state[3] ^= D;
-		ctx->state[4] ^= E;
-		ctx->state[5] ^= F;
-		ctx->state[6] ^= G;
-		ctx->state[7] ^= H;
-		//#ifdef _DEBUG 
-		//		printf("   %08x %08x %08x %08x %08x %08x %08x %08x\n", ctx->state[0], ctx->state[1], ctx->state[2],
-		//			ctx->state[3], ctx->state[4], ctx->state[5], ctx->state[6], ctx->state[7]);
-		//#endif
+	void Sm3::CryptoMulti(const std::vector<const std::string *> &inputs, std::vector<std::string> &outputs) {
+		outputs.resize(inputs.size());
+#if defined(__GNUC__) && defined(__x86_64__)
+		if (Sm3HasAvx2()) {
+			for (size_t i = 0; i < inputs.size(); i += 8) {
+				Sm3MultiLanes(&inputs[i], std::min((size_t)8, inputs.size() - i), &outputs[i]);
+			}
+			return;
+		}
+#endif
+		for (size_t i = 0; i < inputs.size(); i++) {
+			Crypto(*inputs[i], outputs[i]);
+		}
 	}
 
 	/*
@@ -33,6 +33,8 @@ namespace utils {
 		static std::string Crypto(const std::string &input);
 		static void Crypto(unsigned char* str, int len, unsigned char *buf);
 		static void Crypto(const std::string &input, std::string &str);
+		//hashes 8 inputs at a time on the avx2 lanes when the cpu has them, one by one elsewhere
+		static void CryptoMulti(const std::vector<const std::string *> &inputs, std::vector<std::string> &outputs);
 
 	private:
 
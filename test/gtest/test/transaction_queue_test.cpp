@@ -0,0 +1,203 @@
+#if 0
+#include <gtest/gtest.h>
+#include <utils/headers.h>
+#include <common/general.h>
+#include <common/storage.h>
+#include <ledger/ledger_manager.h>
+#include <glue/transaction_queue.h>
+
+//the nonces on chain come from a trie in memory, as GetReady reads them through Environment::AccountFromDB
+class TransactionQueueTest :public testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		bubi::LedgerManager::InitInstance();
+		bubi::HashWrapper::SetLedgerHashType(bubi::HashWrapper::HASH_TYPE_SHA256);
+		tree_ = new bubi::KVTrie();
+		tree_->Init(&db_, std::make_shared<WRITE_BATCH>(), bubi::General::ACCOUNT_PREFIX, 4);
+		bubi::LedgerManager::Instance().tree_ = tree_;
+	}
+	virtual void TearDown()
+	{
+		bubi::LedgerManager::Instance().tree_ = NULL;
+		delete tree_;
+		tree_ = NULL;
+	}
+
+	void SetChainNonce(const std::string &address, int64_t nonce)
+	{
+		protocol::Account account;
+		account.set_address(address);
+		account.set_nonce(nonce);
+		bubi::AccountFrm frm(account);
+		tree_->Set(utils::String::HexStringToBin(address), frm.Serializer());
+	}
+
+	bubi::TransactionFrm::pointer NewTx(const std::string &address, int64_t nonce, int64_t fee = 0)
+	{
+		protocol::TransactionEnv env;
+		env.mutable_transaction()->set_source_address(address);
+		env.mutable_transaction()->set_nonce(nonce);
+		env.mutable_transaction()->set_fee(fee);
+		return std::make_shared<bubi::TransactionFrm>(env, false);
+	}
+
+	static std::vector<int64_t> Nonces(const std::vector<bubi::TransactionFrm::pointer> &txs)
+	{
+		std::vector<int64_t> nonces;
+		for (size_t i = 0; i < txs.size(); i++) {
+			nonces.push_back(txs[i]->GetNonce());
+		}
+		return nonces;
+	}
+
+	bubi::MemoryDbDriver db_;
+	bubi::KVTrie *tree_;
+	bubi::TransactionQueue queue_;
+};
+
+static const std::string ADDRESS_A = "a0000000000000000000000000000000000000000000aa";
+static const std::string ADDRESS_B = "b0000000000000000000000000000000000000000000bb";
+static const std::string ADDRESS_C = "c0000000000000000000000000000000000000000000cc";
+
+//a gap in the nonces keeps the account waiting until the missing one arrives
+TEST_F(TransactionQueueTest, ReadyAfterGapFilled){
+	SetChainNonce(ADDRESS_A, 3);
+	EXPECT_EQ(bubi::TransactionQueue::INSERT_OK, queue_.Insert(NewTx(ADDRESS_A, 5), 100));
+
+	std::vector<bubi::TransactionFrm::pointer> ready, stale;
+	queue_.GetReady(1, 100, bubi::General::TXSET_LIMIT_SIZE, ready, stale);
+	EXPECT_TRUE(ready.empty());
+	EXPECT_TRUE(stale.empty());
+
+	EXPECT_EQ(bubi::TransactionQueue::INSERT_OK, queue_.Insert(NewTx(ADDRESS_A, 4), 100));
+	queue_.GetReady(1, 100, bubi::General::TXSET_LIMIT_SIZE, ready, stale);
+	EXPECT_EQ(std::vector<int64_t>({ 4, 5 }), Nonces(ready));
+	EXPECT_EQ(2, queue_.Size());
+};
+
+//the nonce on chain is loaded once per ledger, the transactions under it go out as stale
+TEST_F(TransactionQueueTest, StaleUnderChainNonce){
+	SetChainNonce(ADDRESS_A, 0);
+	queue_.Insert(NewTx(ADDRESS_A, 2), 100);
+	queue_.Insert(NewTx(ADDRESS_A, 3), 100);
+
+	std::vector<bubi::TransactionFrm::pointer> ready, stale;
+	queue_.GetReady(1, 100, bubi::General::TXSET_LIMIT_SIZE, ready, stale);
+	EXPECT_TRUE(ready.empty());
+
+	//a ledger closed by synchronization moved the nonce, a new lcl reloads it
+	SetChainNonce(ADDRESS_A, 2);
+	queue_.GetReady(1, 100, bubi::General::TXSET_LIMIT_SIZE, ready, stale);
+	EXPECT_TRUE(ready.empty());
+	queue_.GetReady(2, 100, bubi::General::TXSET_LIMIT_SIZE, ready, stale);
+	EXPECT_EQ(std::vector<int64_t>({ 2 }), Nonces(stale));
+	EXPECT_EQ(std::vector<int64_t>({ 3 }), Nonces(ready));
+	EXPECT_EQ(1, queue_.Size());
+};
+
+TEST_F(TransactionQueueTest, InsertDuplicateAndFull){
+	EXPECT_EQ(bubi::TransactionQueue::INSERT_OK, queue_.Insert(NewTx(ADDRESS_A, 1), 2));
+	EXPECT_EQ(bubi::TransactionQueue::INSERT_DUPLICATE, queue_.Insert(NewTx(ADDRESS_A, 1), 2));
+	EXPECT_TRUE(queue_.Has(ADDRESS_A, 1));
+	EXPECT_FALSE(queue_.Has(ADDRESS_A, 2));
+
+	EXPECT_EQ(bubi::TransactionQueue::INSERT_OK, queue_.Insert(NewTx(ADDRESS_B, 1), 2));
+	EXPECT_EQ(bubi::TransactionQueue::INSERT_FULL, queue_.Insert(NewTx(ADDRESS_B, 2), 2));
+	EXPECT_EQ(2, queue_.Size());
+};
+
+//a closed txset drops what it contained, the nonces its sources reached are read again from the db
+TEST_F(TransactionQueueTest, RemoveCommitted){
+	SetChainNonce(ADDRESS_A, 0);
+	for (int64_t nonce = 1; nonce <= 4; nonce++) {
+		queue_.Insert(NewTx(ADDRESS_A, nonce), 100);
+	}
+	queue_.Insert(NewTx(ADDRESS_B, 1), 100);
+
+	protocol::TransactionEnvSet txset;
+	for (int64_t nonce = 1; nonce <= 2; nonce++) {
+		protocol::TransactionEnv *env = txset.add_txs();
+		env->mutable_transaction()->set_source_address(ADDRESS_A);
+		env->mutable_transaction()->set_nonce(nonce);
+	}
+	EXPECT_EQ(2, (int64_t)queue_.RemoveCommitted(txset));
+	EXPECT_EQ(3, queue_.Size());
+
+	//the apply dropped nonce 2, A waits for it again
+	SetChainNonce(ADDRESS_A, 1);
+	SetChainNonce(ADDRESS_B, 0);
+	std::vector<bubi::TransactionFrm::pointer> ready, stale;
+	queue_.GetReady(1, 100, bubi::General::TXSET_LIMIT_SIZE, ready, stale);
+	EXPECT_EQ(std::vector<int64_t>({ 1 }), Nonces(ready));
+	EXPECT_EQ(ADDRESS_B, ready[0]->GetSourceAddress());
+	EXPECT_TRUE(stale.empty());
+
+	//resubmitted it is kept, what is on chain is refused
+	EXPECT_EQ(bubi::TransactionQueue::INSERT_BAD_SEQ, queue_.Insert(NewTx(ADDRESS_A, 1), 100));
+	EXPECT_EQ(bubi::TransactionQueue::INSERT_OK, queue_.Insert(NewTx(ADDRESS_A, 2), 100));
+	ready.clear();
+	queue_.GetReady(1, 100, bubi::General::TXSET_LIMIT_SIZE, ready, stale);
+	EXPECT_EQ(std::vector<int64_t>({ 2, 3, 4, 1 }), Nonces(ready));
+	EXPECT_EQ(4, queue_.Size());
+};
+
+//the budget goes to the highest fees, an account only in nonce order, and the txs come out in address order
+TEST_F(TransactionQueueTest, GetReadyBudget){
+	SetChainNonce(ADDRESS_A, 0);
+	SetChainNonce(ADDRESS_B, 0);
+	SetChainNonce(ADDRESS_C, 0);
+	queue_.Insert(NewTx(ADDRESS_C, 1, 3), 100);
+	queue_.Insert(NewTx(ADDRESS_A, 2, 0), 100);
+	queue_.Insert(NewTx(ADDRESS_B, 1, 5), 100);
+	queue_.Insert(NewTx(ADDRESS_A, 1, 10), 100);
+
+	std::vector<bubi::TransactionFrm::pointer> ready, stale;
+	queue_.GetReady(1, 2, bubi::General::TXSET_LIMIT_SIZE, ready, stale);
+	EXPECT_EQ(std::vector<int64_t>({ 1, 1 }), Nonces(ready));
+	EXPECT_EQ(ADDRESS_A, ready[0]->GetSourceAddress());
+	EXPECT_EQ(ADDRESS_B, ready[1]->GetSourceAddress());
+
+	ready.clear();
+	queue_.GetReady(1, 4, bubi::General::TXSET_LIMIT_SIZE, ready, stale);
+	EXPECT_EQ(std::vector<int64_t>({ 1, 2, 1, 1 }), Nonces(ready));
+	EXPECT_EQ(ADDRESS_C, ready[3]->GetSourceAddress());
+
+	//room for one transaction
+	ready.clear();
+	int64_t size = NewTx(ADDRESS_A, 1, 10)->GetTransactionEnv().ByteSize();
+	queue_.GetReady(1, 4, size + 1, ready, stale);
+	EXPECT_EQ(std::vector<int64_t>({ 1 }), Nonces(ready));
+	EXPECT_EQ(ADDRESS_A, ready[0]->GetSourceAddress());
+	EXPECT_EQ(4, queue_.Size());
+};
+
+//only the transactions received before the expire time leave, oldest first, and the account follows
+TEST_F(TransactionQueueTest, RemoveTimeout){
+	SetChainNonce(ADDRESS_A, 0);
+	bubi::TransactionFrm::pointer txs[] = { NewTx(ADDRESS_A, 2), NewTx(ADDRESS_B, 1), NewTx(ADDRESS_A, 1) };
+	for (size_t i = 0; i < 3; i++) {
+		txs[i]->SetInComingTime(1000 * (i + 1));
+		queue_.Insert(txs[i], 100);
+	}
+
+	std::vector<bubi::TransactionFrm::pointer> timeout_txs;
+	queue_.RemoveTimeout(1000, timeout_txs);
+	EXPECT_TRUE(timeout_txs.empty());
+	queue_.RemoveTimeout(3000, timeout_txs);
+	EXPECT_EQ(2, (int64_t)timeout_txs.size());
+	EXPECT_EQ(1, queue_.Size());
+	EXPECT_FALSE(queue_.Has(ADDRESS_A, 2));
+	EXPECT_FALSE(queue_.Has(ADDRESS_B, 1));
+
+	std::vector<bubi::TransactionFrm::pointer> ready, stale;
+	queue_.GetReady(1, 100, bubi::General::TXSET_LIMIT_SIZE, ready, stale);
+	EXPECT_EQ(std::vector<int64_t>({ 1 }), Nonces(ready));
+
+	timeout_txs.clear();
+	queue_.RemoveTimeout(3001, timeout_txs);
+	EXPECT_EQ(1, (int64_t)timeout_txs.size());
+	EXPECT_EQ(0, queue_.Size());
+};
+#endif
@@ -9,5 +9,6 @@ void TestWebsocket();
 int test_websocketssl();
 void test_sm3();
 void test_sm2();
+void test_sha256();
 void test_bubikey();
 #endif
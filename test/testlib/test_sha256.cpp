@@ -0,0 +1,82 @@
+#include "test.h"
+#include <utils/crypto.h>
+#include <openssl/sha.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) && !defined(OPENSSL_NO_ASM)
+extern "C" unsigned int OPENSSL_ia32cap_P[4];
+#endif
+
+//batches of mixed lengths through Sha256::CryptoMulti against SHA256(), the short inputs first, last and
+//between the long ones, so some lane groups have no whole block
+static int check_sha256_multi() {
+	int nFail = 0;
+	for (size_t short_len = 0; short_len < 130; short_len += 7) {
+		for (size_t pattern = 0; pattern < 16; pattern++) {
+			std::vector<std::string> datas;
+			for (size_t i = 0; i < 1 + pattern % 9 + (pattern / 9) * 8; i++) {
+				bool is_short = ((pattern >> (i % 4)) & 1) != 0;
+				size_t len = is_short ? short_len : 64 + short_len + 61 * i;
+				std::string data;
+				for (size_t j = 0; j < len; j++) {
+					data.push_back((char)(j * 31 + i * 7 + pattern));
+				}
+				datas.push_back(data);
+			}
+
+			std::vector<const std::string *> inputs;
+			for (size_t i = 0; i < datas.size(); i++) {
+				inputs.push_back(&datas[i]);
+			}
+			std::vector<std::string> outputs;
+			utils::Sha256::CryptoMulti(inputs, outputs);
+
+			for (size_t i = 0; i < datas.size(); i++) {
+				unsigned char expect[SHA256_DIGEST_LENGTH];
+				SHA256((const unsigned char *)datas[i].c_str(), datas[i].size(), expect);
+				if (outputs[i] != std::string((const char *)expect, SHA256_DIGEST_LENGTH)) {
+					nFail++;
+				}
+			}
+		}
+	}
+	return nFail;
+}
+
+//every path of the libcrypto multi-buffer sha256 the cpu has, picked through OPENSSL_ia32cap_P
+void test_sha256() {
+#if defined(__x86_64__) && !defined(OPENSSL_NO_ASM)
+	const unsigned int AVX = 1u << 28;   //word 1
+	const unsigned int AVX2 = 1u << 5;   //word 2
+	const unsigned int SHA = 1u << 29;   //word 2
+
+	unsigned int cap1 = OPENSSL_ia32cap_P[1];
+	unsigned int cap2 = OPENSSL_ia32cap_P[2];
+	struct {
+		const char *name;
+		bool supported;
+		unsigned int word1, word2;
+	} paths[] = {
+		{ "sse", true, cap1 & ~AVX, cap2 & ~(AVX2 | SHA) },
+		{ "avx", (cap1 & AVX) != 0, cap1, cap2 & ~(AVX2 | SHA) },
+		{ "avx2", (cap1 & AVX) != 0 && (cap2 & AVX2) != 0, cap1, cap2 & ~SHA },
+		{ "sha-ni", (cap2 & SHA) != 0, cap1, cap2 },
+	};
+
+	for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+		if (!paths[i].supported) {
+			printf("test SHA256 multi %s: not supported\n", paths[i].name);
+			continue;
+		}
+		OPENSSL_ia32cap_P[1] = paths[i].word1;
+		OPENSSL_ia32cap_P[2] = paths[i].word2;
+		printf("test SHA256 multi %s: fail=%d\n", paths[i].name, check_sha256_multi());
+	}
+	OPENSSL_ia32cap_P[1] = cap1;
+	OPENSSL_ia32cap_P[2] = cap2;
+#else
+	printf("test SHA256 multi: fail=%d\n", check_sha256_multi());
+#endif
+}
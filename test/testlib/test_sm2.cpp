@@ -1,57 +1,85 @@
 #include "test.h"
-#include <utils\ecc_sm2.h>
+#include <utils/ecc_sm2.h>
+#include <utils/timestamp.h>
 #include <iostream>
+#include <thread>
+#include <vector>
 
+//the verify of every signature against the one with the point and ZA of the key prepared,
+//then the prepared one on several threads
 void test_sm2() {
-	int nTotal = 1000;
-	int nSuccess = 0;
-	int nFail = 0;
-	//for (int i = 0; i < nTotal; i++) {
-	//	std::string r, s, xA, yA;
-	//	std::string id = "alice";
-	//	std::string msg = "hello";
-
-	//	utils::EccSm2 key(utils::EccSm2::GetCFCAGroup());
-	//	key.NewRandom();
-	//	key.GetPublicKey(xA,yA);
-	//	key.Sign(id, msg, r, s);
-	//	if (utils::EccSm2::verify(utils::EccSm2::GetCFCAGroup(), xA, yA, id, msg, r, s)) {
-	//		nSuccess++;
-	//		printf("success:%d\n",nSuccess);
-	//	}
-	//	else {
-	//		nFail++;
-	//		printf("fail:%d xA.size=%u yA.size=%u r.size=%u s.size=%u\n", 
-	//			nFail, xA.size(), yA.size(), r.size(), s.size());
-	//	}
-	//}
-
-	printf("test SM2 CFCA GROUP:\n");
-	printf("random skey total=%d, success=%d, fail=%d", nTotal, nSuccess, nFail);
-	
-	EC_GROUP * group = utils::EccSm2::NewGroup(utils::EccSm2::F2M,
-		"020000000000000000000000000000000000000000000000000000000000001001",
-		"00",
-		"00E78BCD09746C202378A7E72B12BCE00266B9627ECB0B5A25367AD1AD4CC6242B",
-		"00CDB9CA7F1E6B0441F658343F4B10297C0EF9B6491082400A62E7A7485735FADD",
-		"013DE74DA65951C4D76DC89220D5F7777A611B1C38BAE260B175951DC8060C2B3E",
-		"7FFFFFFFFFFFFFFFFFFFFFFFFFFFFFFFBC972CF7E6B6F900945B3C6A0CF6161D");
-	for (int i = 0; i < 10000;i++)
-	{
-		std::string r, s, xA, yA;
-		std::string id = "alice";
-		std::string msg = "hello";
+	const int nKeys = 10;
+	const int nRounds = 200;
+	const std::string id = "1234567812345678";
+	EC_GROUP *group = utils::EccSm2::GetCFCAGroup();
+
+	std::vector<std::string> pkeys, msgs, sigs, zas;
+	std::vector<EC_POINT *> points;
+	for (int i = 0; i < nKeys; i++) {
 		utils::EccSm2 key(group);
 		key.NewRandom();
-		key.GetPublicKey(xA, yA);
-		key.Sign(id, msg, r, s);
-		bool b = utils::EccSm2::verify(group, xA, yA, id, msg, r, s);
-		if (b) {
-			printf("%d OK\n", i);
+		std::string msg = "hello " + std::to_string(i);
+		pkeys.push_back(key.GetPublicKey());
+		msgs.push_back(msg);
+		sigs.push_back(key.Sign(id, msg));
+		points.push_back(utils::EccSm2::NewPublicKeyPoint(group, pkeys[i]));
+		zas.push_back(utils::EccSm2::getZA(group, id, points[i]));
+	}
+
+	int nFail = 0;
+	for (int i = 0; i < nKeys; i++) {
+		if (utils::EccSm2::verify(group, pkeys[i], id, msgs[i], sigs[i]) != 1 ||
+			utils::EccSm2::verifyZA(group, pkeys[i], zas[i], msgs[i], sigs[i]) != 1 ||
+			utils::EccSm2::verifyZA(group, points[i], zas[i], msgs[i], sigs[i]) != 1) {
+			nFail++;
+		}
+		//a signature of another message must fail on every path
+		if (utils::EccSm2::verify(group, pkeys[i], id, msgs[i] + "!", sigs[i]) != 0 ||
+			utils::EccSm2::verifyZA(group, points[i], zas[i], msgs[i] + "!", sigs[i]) != 0) {
+			nFail++;
+		}
+	}
+	printf("test SM2 CFCA GROUP: keys=%d, fail=%d\n", nKeys, nFail);
+
+	int64_t begin = utils::Timestamp::HighResolution();
+	for (int r = 0; r < nRounds; r++) {
+		for (int i = 0; i < nKeys; i++) {
+			utils::EccSm2::verify(group, pkeys[i], id, msgs[i], sigs[i]);
 		}
-		else {
-			printf("%d fail\n", i);
+	}
+	int64_t verify_us = utils::Timestamp::HighResolution() - begin;
+
+	begin = utils::Timestamp::HighResolution();
+	for (int r = 0; r < nRounds; r++) {
+		for (int i = 0; i < nKeys; i++) {
+			utils::EccSm2::verifyZA(group, points[i], zas[i], msgs[i], sigs[i]);
 		}
 	}
+	int64_t prepared_us = utils::Timestamp::HighResolution() - begin;
+
+	int nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+	std::vector<std::thread> threads;
+	begin = utils::Timestamp::HighResolution();
+	for (int t = 0; t < nThreads; t++) {
+		threads.push_back(std::thread([&]() {
+			for (int r = 0; r < nRounds; r++) {
+				for (int i = 0; i < nKeys; i++) {
+					utils::EccSm2::verifyZA(group, points[i], zas[i], msgs[i], sigs[i]);
+				}
+			}
+		}));
+	}
+	for (size_t t = 0; t < threads.size(); t++) {
+		threads[t].join();
+	}
+	int64_t parallel_us = utils::Timestamp::HighResolution() - begin;
 
-}
\ No newline at end of file
+	int n = nRounds * nKeys;
+	printf("verify: %.1f us/op\n", (double)verify_us / n);
+	printf("verify with prepared key: %.1f us/op\n", (double)prepared_us / n);
+	printf("verify with prepared key on %d threads: %.1f us/op\n", nThreads, (double)parallel_us / (n * nThreads));
+
+	for (int i = 0; i < nKeys; i++) {
+		EC_POINT_free(points[i]);
+	}
+}